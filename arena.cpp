@@ -0,0 +1,43 @@
+#include "arena.hpp"
+
+
+using namespace cli;
+
+constexpr size_t Arena::DEFAULT_BLOCK_SIZE;
+
+
+Arena::Arena(Arena&& arena) noexcept
+  : _block_size(arena._block_size),
+    _blocks(std::move(arena._blocks)),
+    _current(arena._current),
+    _head(arena._head),
+    _tail(arena._tail),
+    _capacity(arena._capacity)
+{
+  arena._blocks.clear();
+  arena._current  = 0;
+  arena._head     = arena._tail = nullptr;
+  arena._capacity = 0;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+void* Arena::allocate_slow(size_t size, size_t alignment)
+{
+  // Use the next kept block large enough, or add one after the current block
+  const auto required = size + alignment - 1;
+  if(required < size) throw std::bad_alloc();
+  auto next = _blocks.empty() ? 0 : _current + 1;
+  while(next < _blocks.size() && _blocks[next].size < required) ++next;
+  if(next == _blocks.size()) {
+    const auto block_size = required > _block_size ? required : _block_size;
+    _blocks.push_back(Block{ std::unique_ptr<char[]>(new char[block_size]), block_size });
+    _capacity += block_size;
+  }
+
+  _current = next;
+  _head = _blocks[next].data.get();
+  _tail = _head + _blocks[next].size;
+  return allocate(size, alignment);
+}
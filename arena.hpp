@@ -0,0 +1,210 @@
+/*!
+ * @file  arena.hpp
+ * @brief Bump allocator for memory living as long as a command
+ */
+#ifndef CLI_BASIC_ENGINE_ARENA_HPP
+#define CLI_BASIC_ENGINE_ARENA_HPP
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+namespace cli {
+
+  /*!
+   * @brief  Bump allocator released all at once
+   * @note   Blocks are kept across reset(), so allocations of the same sizes
+   *         as the previous round reuse them without the heap.
+   *         Destructors of allocated objects are never called.
+   *         It is not thread safe.
+   * @code
+   * // Usage
+   * Arena arena;
+   * auto values = arena.allocate<int>( 16 );
+   * auto copied = arena.copy( "scratch" );
+   * arena.reset();  // values and copied are released
+   * @endcode
+   */
+  class Arena : private boost::noncopyable {
+
+    public:
+    /*!
+     * @var    DEFAULT_BLOCK_SIZE
+     * @brief  Size of blocks allocated unless a larger one is requested
+     */
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
+
+    /*!
+     * @brief      Ctor.
+     * @param[in]  block_size : minimum size of blocks
+     * @note       No block is allocated until the first allocation.
+     */
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE) noexcept
+      : _block_size(block_size > 0 ? block_size : DEFAULT_BLOCK_SIZE)
+    {
+    }
+
+    //! Move ctor.
+    Arena(Arena&& arena) noexcept;
+
+    /*!
+     * @brief      Allocate uninitialized memory
+     * @param[in]  size      : size in bytes
+     * @param[in]  alignment : power of two
+     * @exception  std::bad_alloc : thrown if a new block cannot be allocated
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+      auto head = align(_head, alignment);
+      if(head > _tail || static_cast<size_t>(_tail - head) < size) return allocate_slow(size, alignment);
+      _head = head + size;
+      return head;
+    }
+
+    /*!
+     * @brief      Allocate an uninitialized array
+     * @param[in]  num : the number of elements
+     */
+    template<class T>
+    T* allocate(size_t num)
+    {
+      static_assert(std::is_trivially_destructible<T>::value, "destructors in arenas are never called");
+      if(num > SIZE_MAX / sizeof(T)) throw std::bad_alloc();
+      return static_cast<T*>(allocate(num * sizeof(T), alignof(T)));
+    }
+
+    /*!
+     * @brief      Copy a string into the arena
+     * @param[in]  string : copied string
+     * @return     the copy, which is not null-terminated
+     */
+    boost::string_ref copy(boost::string_ref string)
+    {
+      if(string.empty()) return {};
+      auto data = allocate<char>(string.size());
+      std::memcpy(data, string.data(), string.size());
+      return boost::string_ref(data, string.size());
+    }
+
+    /*!
+     * @brief   Release all allocations in O(1)
+     * @note    Blocks are kept for the following allocations.
+     */
+    void reset() noexcept
+    {
+      _current = 0;
+      if(_blocks.empty()) return;
+      _head = _blocks.front().data.get();
+      _tail = _head + _blocks.front().size;
+    }
+
+    //! Returns the total size of the blocks
+    size_t capacity() const noexcept
+    {
+      return _capacity;
+    }
+
+    //! Returns the number of the blocks
+    size_t num_blocks() const noexcept
+    {
+      return _blocks.size();
+    }
+
+
+    private:
+    struct Block {
+      std::unique_ptr<char[]> data;
+      size_t                  size;
+    };
+
+    static char* align(char* pointer, size_t alignment) noexcept
+    {
+      const auto address = reinterpret_cast<uintptr_t>(pointer);
+      return pointer + ((alignment - address % alignment) % alignment);
+    }
+
+    void* allocate_slow(size_t size, size_t alignment);
+
+    private:
+    size_t             _block_size;
+    std::vector<Block> _blocks;
+    size_t             _current = 0;  // index of the block in use
+    char*              _head = nullptr;
+    char*              _tail = nullptr;
+    size_t             _capacity = 0;
+
+  };
+
+
+  /*!
+   * @brief  Allocator of standard containers backed by an arena
+   * @note   Deallocation does nothing; the memory is released by Arena::reset().
+   * @code
+   * // Usage
+   * std::vector<int, ArenaAllocator<int>> values( ArenaAllocator<int>(arena) );
+   * values.push_back( 42 );
+   * @endcode
+   */
+  template<class T>
+  class ArenaAllocator {
+
+    public:
+    using value_type = T;
+
+    //! Ctor. with the arena providing memory
+    explicit ArenaAllocator(Arena& arena) noexcept
+      : _arena(&arena)
+    {
+    }
+
+    //! Converting ctor.
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& allocator) noexcept
+      : _arena(&allocator.arena())
+    {
+    }
+
+    T* allocate(size_t num)
+    {
+      if(num > SIZE_MAX / sizeof(T)) throw std::bad_alloc();
+      return static_cast<T*>(_arena->allocate(num * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept
+    {
+    }
+
+    //! Returns the arena
+    Arena& arena() const noexcept
+    {
+      return *_arena;
+    }
+
+    private:
+    Arena* _arena;
+
+  };
+
+  template<class T, class U>
+  bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+  {
+    return &lhs.arena() == &rhs.arena();
+  }
+
+  template<class T, class U>
+  bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_ARENA_HPP */
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "argument_schema.hpp"
+#include "command.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  // Powers of 10 represented exactly in double
+  constexpr double EXACT_POWERS_OF_10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  constexpr int MAX_EXACT_EXPONENT = 22;
+  constexpr unsigned long long MAX_EXACT_MANTISSA = 1ull << 53;
+  constexpr int MAX_DIGITS = 19;
+
+  inline bool is_digit(char c) noexcept
+  {
+    return '0' <= c && c <= '9';
+  }
+
+  //! Convert the pattern by strtod(), which needs a terminated string
+  std::errc convert_by_strtod(const char* first, const char* last, double& value) noexcept
+  {
+    char stack_buffer[128];
+    std::unique_ptr<char[]> heap_buffer;
+    auto buffer = stack_buffer;
+    const auto size = static_cast<size_t>(last - first);
+    if(size >= sizeof(stack_buffer)) {
+      // Patterns with hundreds of digits are valid but rare enough to allocate for
+      heap_buffer.reset(new (std::nothrow) char[size + 1]);
+      if(!heap_buffer) return std::errc::not_enough_memory;
+      buffer = heap_buffer.get();
+    }
+    std::memcpy(buffer, first, size);
+    buffer[size] = '\0';
+    errno = 0;
+    auto converted = std::strtod(buffer, nullptr);
+    // Overflow and underflow to zero are out of range; subnormal results are kept
+    if(errno == ERANGE && (std::isinf(converted) || converted == 0)) return std::errc::result_out_of_range;
+    value = converted;
+    return std::errc();
+  }
+
+  const char* type_name(ArgumentType type) noexcept
+  {
+    switch(type) {
+      case ArgumentType::INTEGER:
+        return "an integer";
+      case ArgumentType::REAL:
+        return "a real number";
+      default:
+        return "a string";
+    }
+  }
+
+  //! Write the error of the argument
+  void write_argument_error(Command& command, const ArgumentSchema::Argument& argument,
+                            Command::view_type value, bool bounded)
+  {
+    const auto name = command.name_view();
+    auto& stream = command.fail();
+    stream << "Command '" << name << "' requires " << type_name(argument.type);
+    if(bounded) {
+      stream << " in [";
+      if(argument.type == ArgumentType::INTEGER) {
+        stream << argument.min_integer << ", " << argument.max_integer;
+      } else {
+        stream << argument.min_real << ", " << argument.max_real;
+      }
+      stream << ']';
+    }
+    stream << " for '" << argument.name << "': " << value;
+  }
+
+}
+
+
+from_chars_result cli::from_chars(const char* first, const char* last, long long& value) noexcept
+{
+  auto p = first;
+  const bool negative = p != last && *p == '-';
+  if(negative) ++p;
+  const auto digits = p;
+
+  // Accumulate the magnitude as a negative number to accept the minimum value
+  long long accumulated = 0;
+  bool overflow = false;
+  constexpr auto min = std::numeric_limits<long long>::min();
+  for( ; p != last && is_digit(*p); ++p ) {
+    const int digit = *p - '0';
+    if(accumulated < (min + digit) / 10) overflow = true;
+    if(!overflow) accumulated = accumulated * 10 - digit;
+  }
+
+  if(p == digits) return { first, std::errc::invalid_argument };
+  if(overflow || (!negative && accumulated == min)) return { p, std::errc::result_out_of_range };
+  value = negative ? accumulated : -accumulated;
+  return { p, std::errc() };
+}
+
+
+from_chars_result cli::from_chars(const char* first, const char* last, double& value) noexcept
+{
+  auto p = first;
+  const bool negative = p != last && *p == '-';
+  if(negative) ++p;
+
+  unsigned long long mantissa = 0;
+  int num_digits = 0;     // significant digits accumulated in the mantissa
+  int exponent = 0;
+  bool has_digits = false;
+  bool exact = true;
+  for( ; p != last && is_digit(*p); ++p ) {
+    has_digits = true;
+    if(mantissa == 0 && *p == '0') continue;
+    if(num_digits < MAX_DIGITS) {
+      mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+      ++num_digits;
+    } else {
+      ++exponent, exact = false;
+    }
+  }
+  if(p != last && *p == '.') {
+    auto fraction = p + 1;
+    for( ; fraction != last && is_digit(*fraction); ++fraction ) {
+      has_digits = true;
+      if(mantissa == 0 && *fraction == '0') {
+        --exponent;
+      } else if(num_digits < MAX_DIGITS) {
+        mantissa = mantissa * 10 + static_cast<unsigned>(*fraction - '0');
+        ++num_digits, --exponent;
+      } else {
+        exact = false;
+      }
+    }
+    if(has_digits) p = fraction;
+  }
+  if(!has_digits) return { first, std::errc::invalid_argument };
+
+  if(p != last && (*p == 'e' || *p == 'E')) {
+    auto e = p + 1;
+    const bool negative_exponent = e != last && *e == '-';
+    if(e != last && (*e == '-' || *e == '+')) ++e;
+    if(e != last && is_digit(*e)) {
+      int explicit_exponent = 0;
+      for( ; e != last && is_digit(*e); ++e ) {
+        if(explicit_exponent < 100000) explicit_exponent = explicit_exponent * 10 + (*e - '0');
+      }
+      exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+      p = e;
+    }
+  }
+
+  // Fast path: both the mantissa and the power of 10 are exact
+  if(exact && mantissa <= MAX_EXACT_MANTISSA &&
+     -MAX_EXACT_EXPONENT <= exponent && exponent <= MAX_EXACT_EXPONENT) {
+    auto converted = static_cast<double>(mantissa);
+    converted = exponent < 0 ? converted / EXACT_POWERS_OF_10[-exponent]
+                             : converted * EXACT_POWERS_OF_10[exponent];
+    value = negative ? -converted : converted;
+    return { p, std::errc() };
+  }
+
+  return { p, convert_by_strtod(first, p, value) };
+}
+
+
+//--------------------------------------------------------
+ArgumentSchema& ArgumentSchema::string(std::string name)
+{
+  return declare(Argument{ std::move(name), ArgumentType::STRING, 0, 0, 0.0, 0.0 });
+}
+
+
+ArgumentSchema& ArgumentSchema::integer(std::string name, long long min, long long max)
+{
+  return declare(Argument{ std::move(name), ArgumentType::INTEGER, min, max, 0.0, 0.0 });
+}
+
+
+ArgumentSchema& ArgumentSchema::real(std::string name, double min, double max)
+{
+  return declare(Argument{ std::move(name), ArgumentType::REAL, 0, 0, min, max });
+}
+
+
+ArgumentSchema& ArgumentSchema::optional()
+{
+  if(_arguments.empty()) throw std::logic_error("no argument is declared");
+  if(!_optional) {
+    _optional = true;
+    _num_required = _arguments.size() - 1;
+  }
+  return *this;
+}
+
+
+ArgumentSchema& ArgumentSchema::variadic()
+{
+  if(_arguments.empty()) throw std::logic_error("no argument is declared");
+  _variadic = true;
+  return *this;
+}
+
+
+bool ArgumentSchema::validate(Command& command) const noexcept
+{
+  const auto num = command.num_arguments();
+  const auto num_declared = _arguments.size();
+  if(num < _num_required || (!_variadic && num > num_declared)) {
+    if(_num_required == num_declared && !_variadic) {
+      return check_num_arguments_equal(command, num_declared, std::nothrow);
+    }
+    return num < _num_required ? check_num_arguments_at_least(command, _num_required, std::nothrow)
+                               : check_num_arguments_at_most(command, num_declared, std::nothrow);
+  }
+
+  for(size_t i = 0; i < num; ++i) {
+    const auto& argument = _arguments[std::min(i, num_declared - 1)];
+    const auto token = command.argument_view(i);
+    const auto last = token.data() + token.size();
+    try {
+      switch(argument.type) {
+        case ArgumentType::INTEGER: {
+          long long value = 0;
+          auto result = from_chars(token.data(), last, value);
+          if(result.ec == std::errc::invalid_argument || result.ptr != last) {
+            return write_argument_error(command, argument, token, false), false;
+          }
+          if(result.ec != std::errc() || value < argument.min_integer || argument.max_integer < value) {
+            return write_argument_error(command, argument, token, true), false;
+          }
+          command.set_integer_argument(i, value);
+          break;
+        }
+        case ArgumentType::REAL: {
+          double value = 0.0;
+          auto result = from_chars(token.data(), last, value);
+          if(result.ec == std::errc::invalid_argument || result.ptr != last) {
+            return write_argument_error(command, argument, token, false), false;
+          }
+          if(result.ec != std::errc() || value < argument.min_real || argument.max_real < value) {
+            return write_argument_error(command, argument, token, true), false;
+          }
+          command.set_real_argument(i, value);
+          break;
+        }
+        default:
+          break;
+      }
+    } catch(...) {
+      // The command is marked as failed even if the message is not written
+      command.fail();
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+ArgumentSchema& ArgumentSchema::declare(Argument argument)
+{
+  if(_variadic) throw std::logic_error("no argument can follow the variadic argument");
+  _arguments.emplace_back(std::move(argument));
+  if(!_optional) _num_required = _arguments.size();
+  return *this;
+}
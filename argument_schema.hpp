@@ -0,0 +1,155 @@
+/*!
+ * @file  argument_schema.hpp
+ * @brief Declarative argument schema of commands
+ */
+#ifndef CLI_BASIC_ENGINE_ARGUMENT_SCHEMA_HPP
+#define CLI_BASIC_ENGINE_ARGUMENT_SCHEMA_HPP
+
+#include <limits>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cstddef>
+
+
+namespace cli {
+
+  class Command;
+
+  /*!
+   * @brief  Result of from_chars(), the same as std::from_chars_result of C++17
+   */
+  struct from_chars_result {
+    const char* ptr;  //!< the first character not matching the pattern
+    std::errc   ec;   //!< std::errc() on success
+  };
+
+  /*!
+   * @brief       Parse a decimal integer in [first, last)
+   * @param[out]  value : parsed value, unchanged on error
+   * @note        It behaves like std::from_chars of C++17: no leading white spaces nor '+'
+   *              are accepted, and the locale is not used.
+   */
+  from_chars_result from_chars(const char* first, const char* last, long long& value) noexcept;
+
+  /*!
+   * @brief       Parse a decimal floating point number in [first, last)
+   * @param[out]  value : parsed value, unchanged on error
+   * @note        Numbers with up to 19 significant digits and small exponents are converted
+   *              exactly without strtod(). Numbers too large, or too small to be nonzero,
+   *              are out of range.
+   */
+  from_chars_result from_chars(const char* first, const char* last, double& value) noexcept;
+
+
+  //! Types of arguments in the schema
+  enum struct ArgumentType {
+    STRING, INTEGER, REAL
+  };
+
+
+  /*!
+   * @brief  Argument schema of a command, validated once before the callback is called
+   * @note   Arguments are declared in order. Optional arguments follow the required ones,
+   *         and a variadic argument, which matches the rest, comes last.
+   *         Parsed numbers are available through Command::integer_argument() and
+   *         Command::real_argument() in the callback.
+   * @code
+   * // Usage: resize <width> <height> [ratio]
+   * auto schema = ArgumentSchema().integer("width", 1, 4096)
+   *                               .integer("height", 1, 4096)
+   *                               .real("ratio", 0.0, 1.0).optional();
+   *
+   * Command command( "resize 640 480" );
+   * if( schema.validate(command) ) {
+   *   assert( command.integer_argument(0) == 640 );
+   * }
+   * @endcode
+   */
+  class ArgumentSchema {
+
+    public:
+    //! Declaration of an argument
+    struct Argument {
+      std::string  name;
+      ArgumentType type;
+      long long    min_integer;
+      long long    max_integer;
+      double       min_real;
+      double       max_real;
+    };
+
+    //! Default ctor. declares no argument
+    ArgumentSchema() noexcept
+      : _num_required(0), _optional(false), _variadic(false)
+    {}
+
+    //! Declare a string argument
+    ArgumentSchema& string(std::string name);
+
+    //! Declare an integer argument in [min, max]
+    ArgumentSchema& integer(std::string name,
+                            long long min = std::numeric_limits<long long>::min(),
+                            long long max = std::numeric_limits<long long>::max());
+
+    //! Declare a real number argument in [min, max]
+    ArgumentSchema& real(std::string name,
+                         double min = -std::numeric_limits<double>::infinity(),
+                         double max = std::numeric_limits<double>::infinity());
+
+    /*!
+     * @brief      Make the last declared argument optional
+     * @note       The arguments declared after it are optional as well.
+     * @exception  std::logic_error : thrown if no argument is declared
+     */
+    ArgumentSchema& optional();
+
+    /*!
+     * @brief      Make the last declared argument match the rest of arguments
+     * @note       It is required at least once unless optional() is also called.
+     * @exception  std::logic_error : thrown if no argument is declared
+     */
+    ArgumentSchema& variadic();
+
+    /*!
+     * @brief       Validate the arguments, and store the parsed numbers in the command
+     * @retval      true  : the arguments satisfy the schema
+     * @retval      false : the command is marked as failed with the reason
+     * @note        The arity errors are the same as check_num_arguments_* helpers.
+     */
+    bool validate(Command& command) const noexcept;
+
+    //! Returns the declared arguments
+    const std::vector<Argument>& arguments() const noexcept
+    {
+      return _arguments;
+    }
+
+    //! Returns the number of required arguments
+    size_t num_required() const noexcept
+    {
+      return _num_required;
+    }
+
+    //! Check the last argument is variadic
+    bool variadic_declared() const noexcept
+    {
+      return _variadic;
+    }
+
+
+    private:
+    ArgumentSchema& declare(Argument argument);
+
+    private:
+    std::vector<Argument> _arguments;
+    size_t                _num_required;
+    bool                  _optional;  // optional arguments are declared
+    bool                  _variadic;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_ARGUMENT_SCHEMA_HPP */
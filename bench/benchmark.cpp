@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <new>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.hpp"
+
+
+using namespace cli::bench;
+
+namespace {
+
+  std::atomic<size_t> allocation_counter(0);
+
+  // Time of a sample; long enough to hide the overhead of the clock
+  constexpr auto SAMPLE_TIME = std::chrono::microseconds(20);
+  constexpr size_t MIN_SAMPLES = 100;
+
+  double percentile(const std::vector<double>& sorted, double ratio)
+  {
+    auto index = static_cast<size_t>(ratio * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+  }
+
+  const char* sampling_name(Sampling sampling) noexcept
+  {
+    return sampling == Sampling::BATCH ? "batch" : "call";
+  }
+
+  void write_json_string(std::ostream& os, const std::string& str)
+  {
+    os << '"';
+    for(auto c : str) {
+      if(c == '"' || c == '\\') {
+        os << '\\' << c;
+      } else if(static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        os << escaped;
+      } else {
+        os << c;
+      }
+    }
+    os << '"';
+  }
+
+}
+
+
+// Count heap allocations of the benchmark process
+void* operator new(size_t size)
+{
+  allocation_counter.fetch_add(1, std::memory_order_relaxed);
+  if(auto p = std::malloc(size > 0 ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+
+size_t cli::bench::num_allocations() noexcept
+{
+  return allocation_counter.load(std::memory_order_relaxed);
+}
+
+
+Runner::Runner(duration_type min_time, std::string filter)
+  : _min_time(min_time), _filter(std::move(filter))
+{}
+
+
+bool Runner::selected(const std::string& name) const
+{
+  return _filter.empty() || name.find(_filter) != std::string::npos;
+}
+
+
+void Runner::run(const std::string& name, const function_type& operation, size_t ops_per_call)
+{
+  if(!selected(name)) return;
+
+  // Warm up, and calibrate the number of calls in a sample
+  size_t batch = 1;
+  for(;;) {
+    auto start = clock_type::now();
+    for(size_t i = 0; i < batch; ++i) operation();
+    if(clock_type::now() - start >= SAMPLE_TIME) break;
+    batch *= 2;
+  }
+
+  std::vector<double> samples;
+  size_t num_calls = 0;
+  duration_type elapsed(0);
+  const auto allocations = num_allocations();
+  while(elapsed < _min_time || samples.size() < MIN_SAMPLES) {
+    auto start = clock_type::now();
+    for(size_t i = 0; i < batch; ++i) operation();
+    auto time = clock_type::now() - start;
+    elapsed += time, num_calls += batch;
+    samples.push_back(std::chrono::duration<double, std::nano>(time).count() / static_cast<double>(batch * ops_per_call));
+  }
+  const auto num_operations = num_calls * ops_per_call;
+
+  std::sort(samples.begin(), samples.end());
+  _results.push_back(Measurement{
+    name,
+    num_operations,
+    std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(num_operations),
+    static_cast<double>(num_allocations() - allocations) / static_cast<double>(num_operations),
+    Sampling::BATCH,
+    percentile(samples, 0.50),
+    percentile(samples, 0.90),
+    percentile(samples, 0.99),
+    samples.back()
+  });
+}
+
+
+void Runner::run_each(const std::string& name, const function_type& operation, const function_type& teardown)
+{
+  if(!selected(name)) return;
+
+  for(size_t i = 0; i < MIN_SAMPLES; ++i) {  // warm up
+    operation();
+    if(teardown) teardown();
+  }
+
+  std::vector<double> samples;
+  duration_type elapsed(0);
+  const auto allocations = num_allocations();
+  while(elapsed < _min_time || samples.size() < MIN_SAMPLES) {
+    auto start = clock_type::now();
+    operation();
+    auto time = clock_type::now() - start;
+    if(teardown) teardown();
+    elapsed += time;
+    samples.push_back(std::chrono::duration<double, std::nano>(time).count());
+  }
+
+  std::sort(samples.begin(), samples.end());
+  _results.push_back(Measurement{
+    name,
+    samples.size(),
+    std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(samples.size()),
+    static_cast<double>(num_allocations() - allocations) / static_cast<double>(samples.size()),
+    Sampling::CALL,
+    percentile(samples, 0.50),
+    percentile(samples, 0.90),
+    percentile(samples, 0.99),
+    samples.back()
+  });
+}
+
+
+void Runner::report(std::ostream& os) const
+{
+  const auto flags = os.flags();
+  os << std::left << std::setw(36) << "benchmark" << std::right
+     << std::setw(12) << "ns/op" << std::setw(10) << "allocs/op" << std::setw(7) << "sample"
+     << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max"
+     << '\n';
+  os << std::fixed;
+  for(const auto& result : _results) {
+    os << std::left << std::setw(36) << result.name << std::right
+       << std::setprecision(1) << std::setw(12) << result.ns_per_op
+       << std::setprecision(2) << std::setw(10) << result.allocations_per_op
+       << std::setw(7) << sampling_name(result.sampling)
+       << std::setprecision(1)
+       << std::setw(10) << result.p50 << std::setw(10) << result.p90
+       << std::setw(10) << result.p99 << std::setw(10) << result.max << '\n';
+  }
+  os.flags(flags);
+}
+
+
+void Runner::write_json(std::ostream& os) const
+{
+  os << "{\n  \"benchmarks\": [";
+  for(size_t i = 0; i < _results.size(); ++i) {
+    const auto& result = _results[i];
+    os << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+    write_json_string(os, result.name);
+    os << ", \"operations\": " << result.num_operations
+       << ", \"ns_per_op\": " << result.ns_per_op
+       << ", \"allocations_per_op\": " << result.allocations_per_op
+       << ", \"sampling\": \"" << sampling_name(result.sampling) << '"'
+       << ", \"p50_ns\": " << result.p50
+       << ", \"p90_ns\": " << result.p90
+       << ", \"p99_ns\": " << result.p99
+       << ", \"max_ns\": " << result.max << '}';
+  }
+  os << "\n  ]\n}\n";
+}
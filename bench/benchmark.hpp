@@ -0,0 +1,116 @@
+/*!
+ * @file  benchmark.hpp
+ * @brief Minimal runner of microbenchmarks
+ */
+#ifndef CLI_BASIC_ENGINE_BENCH_BENCHMARK_HPP
+#define CLI_BASIC_ENGINE_BENCH_BENCHMARK_HPP
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+
+
+namespace cli {
+namespace bench {
+
+  //! Returns the number of heap allocations in the process so far
+  size_t num_allocations() noexcept;
+
+  //! What a sample of the percentiles measures
+  enum struct Sampling {
+    BATCH,  //!< average ns/op of a calibrated batch of calls
+    CALL    //!< a single call
+  };
+
+  //! Result of a benchmark
+  struct Measurement {
+    std::string name;
+    size_t      num_operations;
+    double      ns_per_op;
+    double      allocations_per_op;
+    Sampling    sampling;
+    double      p50;   // percentiles of ns/op over samples
+    double      p90;
+    double      p99;
+    double      max;
+  };
+
+
+  /*!
+   * @brief  Runner measuring operations in samples of calibrated batches
+   * @note   Each sample times a batch of calls lasting about SAMPLE_TIME, so the
+   *         percentiles are of the average ns/op in a batch, not of single calls.
+   * @code
+   * // Usage
+   * Runner runner( std::chrono::milliseconds(500), "parse" );
+   * Command command;
+   * runner.run( "command/parse", [&]{ command.parse("echo hello"); } );
+   * runner.report( std::cout );
+   * @endcode
+   */
+  class Runner : private boost::noncopyable {
+
+    public:
+    using clock_type    = std::chrono::steady_clock;
+    using duration_type = clock_type::duration;
+    using function_type = std::function<void()>;
+
+    /*!
+     * @brief      Ctor.
+     * @param[in]  min_time : minimum measuring time of each benchmark
+     * @param[in]  filter   : run benchmarks whose names contain it (empty for all)
+     */
+    Runner(duration_type min_time, std::string filter);
+
+    //! Check the benchmark is selected by the filter
+    bool selected(const std::string& name) const;
+
+    /*!
+     * @brief      Measure the operation
+     * @param[in]  name          : name of the benchmark
+     * @param[in]  operation     : function performing operations
+     * @param[in]  ops_per_call  : the number of operations in a call, e.g. lines in an input
+     * @note       Nothing is done if the benchmark is not selected.
+     */
+    void run(const std::string& name, const function_type& operation, size_t ops_per_call = 1);
+
+    /*!
+     * @brief      Measure each call of the operation, e.g. a round trip of a request
+     * @param[in]  name      : name of the benchmark
+     * @param[in]  operation : function performing an operation
+     * @param[in]  teardown  : function called after each operation, which is not measured
+     * @note       The percentiles are of single calls, so the operation has to take long
+     *             enough to hide the overhead of the clock.
+     */
+    void run_each(const std::string& name, const function_type& operation,
+                  const function_type& teardown = nullptr);
+
+    //! Write the results as a table; the 'sample' column tells what the percentiles are of
+    void report(std::ostream& os) const;
+
+    //! Write the results as JSON
+    void write_json(std::ostream& os) const;
+
+    //! Returns the results
+    const std::vector<Measurement>& results() const noexcept
+    {
+      return _results;
+    }
+
+
+    private:
+    duration_type            _min_time;
+    std::string              _filter;
+    std::vector<Measurement> _results;
+
+  };
+
+}
+}
+
+#endif  /* CLI_BASIC_ENGINE_BENCH_BENCHMARK_HPP */
@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../engine.hpp"
+#include "../command.hpp"
+#include "../failure.hpp"
+#include "../hash_map.hpp"
+#include "../protocol.hpp"
+#include "benchmark.hpp"
+
+
+extern char** environ;
+
+using namespace cli;
+using namespace cli::bench;
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+
+namespace {
+
+  // Results of benchmarks which would be optimized out unless stored
+  volatile size_t lookup_sink = 0;
+
+  //! Stream buffer discarding output
+  class NullBuffer : public std::streambuf {
+    protected:
+    int_type overflow(int_type c) override
+    {
+      return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize n) override
+    {
+      return n;
+    }
+  };
+
+  //! Stream buffer reading a string without copying it
+  class InputBuffer : public std::streambuf {
+    public:
+    explicit InputBuffer(const std::string& input)
+      : _input(input)
+    {
+      rewind();
+    }
+
+    void rewind()
+    {
+      auto data = const_cast<char*>(_input.data());
+      setg(data, data, data + _input.size());
+    }
+
+    private:
+    const std::string& _input;
+  };
+
+  //! Stream buffer writing to a file descriptor
+  class FdBuffer : public std::streambuf {
+    public:
+    explicit FdBuffer(int fd)
+      : _fd(fd)
+    {
+      setp(_buffer, _buffer + sizeof(_buffer));
+    }
+
+    protected:
+    int_type overflow(int_type c) override
+    {
+      if(sync() != 0) return traits_type::eof();
+      if(!traits_type::eq_int_type(c, traits_type::eof())) sputc(traits_type::to_char_type(c));
+      return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+      for(auto head = pbase(); head < pptr(); ) {
+        auto size = ::write(_fd, head, pptr() - head);
+        if(size <= 0) return -1;
+        head += size;
+      }
+      setp(_buffer, _buffer + sizeof(_buffer));
+      return 0;
+    }
+
+    private:
+    int  _fd;
+    char _buffer[64 * 1024];
+  };
+
+  //! Engine exposing the dispatcher
+  class BenchEngine : public Engine {
+    public:
+    BenchEngine()
+    {
+      register_callback("fail_throw", [](Command& command){
+        check_num_arguments_equal(command, 0);
+      });
+      register_callback("fail_status", [](Command& command){
+        check_num_arguments_equal(command, 0, std::nothrow);
+      });
+      register_callback("add", [](Command& command){
+        command.response_stream() << command.integer_argument(0) + command.integer_argument(1);
+      }, ArgumentSchema().integer("lhs").integer("rhs"));
+      register_callback("sort", [](Command& command){
+        // Temporaries of the callback from the scratch arena
+        auto& scratch = command.scratch();
+        std::vector<boost::string_ref, ArenaAllocator<boost::string_ref>> words{ ArenaAllocator<boost::string_ref>(scratch) };
+        for(size_t i = 0; i < command.num_arguments(); ++i) words.push_back(command.argument_view(i));
+        std::sort(words.begin(), words.end());
+        for(auto word : words) command.response_stream() << word << ' ';
+      });
+      // Typical size of the command set of derived engines
+      for(auto i = 0; i < 100; ++i) {
+        register_callback("command_" + std::to_string(i), [](Command&){});
+      }
+    }
+
+    void initialize_quietly()
+    {
+      const char* argv[] = { "cli_basic_engine_bench", "--disable-logging" };
+      initialize(2, argv);
+    }
+
+    using Engine::handle_command;
+  };
+
+  std::vector<std::string> command_names()
+  {
+    std::vector<std::string> names{ "echo", "list_commands", "help", "quit" };
+    for(auto i = 0; i < 100; ++i) names.push_back("command_" + std::to_string(i));
+    return names;
+  }
+
+  void bench_command(Runner& runner)
+  {
+    Command command;
+    runner.run("command/parse", [&]{ command.parse("set  key 12345 0.5 with some more words"); });
+    runner.run("command/parse_many_arguments", [&]{ command.parse("sum 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16"); });
+  }
+
+  void bench_hash_map(Runner& runner)
+  {
+    const auto names = command_names();
+    std::vector<boost::string_ref> keys;
+    for(size_t i = 0; i < names.size(); ++i) keys.push_back(names[(i * 37) % names.size()]);
+    keys.push_back("unknown");
+
+    HashMap<int> map;
+    for(size_t i = 0; i < names.size(); ++i) map.emplace(names[i], static_cast<int>(i));
+
+    size_t index = 0, found = 0;
+    runner.run("hash_map/find", [&]{
+      found += map.find(keys[index]) != map.end();
+      if(++index == keys.size()) index = 0;
+    });
+    // Keep the lookups from being optimized out
+    lookup_sink = found;
+  }
+
+  void bench_handle_command(Runner& runner)
+  {
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    BenchEngine engine;
+    engine.initialize_quietly();
+
+    Arena scratch;
+    const auto run = [&](const std::string& name, const char* line){
+      Command command(line);
+      command.set_scratch(&scratch);
+      runner.run(name, [&]{
+        command.clear();
+        engine.handle_command(command, null_stream);
+      });
+    };
+    run("handle_command/echo", "echo hello world");
+    run("handle_command/schema", "add 12345 -678");
+    run("handle_command/scratch", "sort kiwi apple fig banana cherry date grape lemon mango");
+    run("handle_command/unknown", "unknown command");
+    run("handle_command/failure_throw", "fail_throw 1");
+    run("handle_command/failure_status", "fail_status 1");
+
+    BenchEngine stats_engine;
+    const char* argv[] = { "cli_basic_engine_bench", "--disable-logging", "--stats" };
+    stats_engine.initialize(3, argv);
+    Command command("echo hello world");
+    runner.run("handle_command/echo_stats", [&]{
+      command.clear();
+      stats_engine.handle_command(command, null_stream);
+    });
+  }
+
+  void bench_main_loop(Runner& runner)
+  {
+    constexpr size_t NUM_LINES = 1000;
+    std::string input;
+    for(size_t i = 0; i < NUM_LINES; ++i) {
+      input += i % 10 == 0 ? "# comment\n" : "echo hello world " + std::to_string(i) + '\n';
+    }
+
+    // The same commands in binary frames, skipping comments
+    std::string binary_input = "protocol binary\n";
+    for(size_t i = 0; i < NUM_LINES; ++i) {
+      if(i % 10 == 0) continue;
+      const auto number = std::to_string(i);
+      frame::encode_request({ "echo", "hello", "world", number }, binary_input);
+    }
+
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    const auto run = [&](const std::string& name, const std::string& input, const char* mode){
+      InputBuffer input_buffer(input);
+      std::istream input_stream(&input_buffer);
+      BenchEngine engine;
+      std::vector<const char*> argv{ "cli_basic_engine_bench", "--disable-logging" };
+      if(mode) argv.push_back(mode);
+      engine.initialize(static_cast<int>(argv.size()), argv.data());
+      runner.run(name, [&]{
+        input_buffer.rewind();
+        input_stream.clear();
+        engine.main_loop(input_stream, null_stream);
+      }, NUM_LINES);
+    };
+    run("main_loop/echo", input, nullptr);
+    run("main_loop/pipelined", input, "--pipelined");
+    run("main_loop/binary", binary_input, nullptr);
+  }
+
+  void bench_startup(Runner& runner)
+  {
+    // Work of a process before the first prompt, without the loader
+    runner.run("startup/engine", []{
+      Engine engine;
+      const char* argv[] = { "cli_basic_engine_bench", "--disable-logging" };
+      engine.initialize(2, argv);
+    });
+
+#ifdef CLI_BASIC_ENGINE_EXEC
+    // From exec of the engine to its first prompt; the end of input stops it after the measurement
+    pid_t pid = -1;
+    int input[2] = { -1, -1 }, output[2] = { -1, -1 };
+    runner.run_each("startup/exec", [&]{
+      if(::pipe(input) != 0 || ::pipe(output) != 0) return;
+      posix_spawn_file_actions_t actions;
+      posix_spawn_file_actions_init(&actions);
+      posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+      posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+      for(auto fd : { input[0], input[1], output[0], output[1] }) posix_spawn_file_actions_addclose(&actions, fd);
+      std::string path(CLI_BASIC_ENGINE_EXEC), option("--disable-logging");
+      char* argv[] = { &path[0], &option[0], nullptr };
+      if(posix_spawn(&pid, argv[0], &actions, nullptr, argv, environ) != 0) pid = -1;
+      posix_spawn_file_actions_destroy(&actions);
+      ::close(input[0]);
+      ::close(output[1]);
+      char prompt[2];
+      for(size_t size = 0; pid >= 0 && size < sizeof(prompt); ) {
+        auto read = ::read(output[0], prompt + size, sizeof(prompt) - size);
+        if(read <= 0) break;
+        size += read;
+      }
+    }, [&]{
+      ::close(input[1]);
+      char rest[64];
+      while(::read(output[0], rest, sizeof(rest)) > 0);
+      ::close(output[0]);
+      if(pid >= 0) ::waitpid(pid, nullptr, 0);
+    });
+#endif
+  }
+
+  void bench_round_trip(Runner& runner)
+  {
+    // A client sends a command, and waits for its response through pipes
+    const auto run = [&](const std::string& name, const char* mode){
+      if(!runner.selected(name)) return;
+      int input[2], output[2];
+      if(::pipe(input) != 0 || ::pipe(output) != 0) {
+        std::cerr << "failed to create pipes for " << name << '\n';
+        return;
+      }
+      BenchEngine engine;
+      std::vector<const char*> argv{ "cli_basic_engine_bench", "--disable-logging" };
+      if(mode) argv.push_back(mode);
+      engine.initialize(static_cast<int>(argv.size()), argv.data());
+      std::thread server([&]{
+        FdBuffer buffer(output[1]);
+        std::ostream os(&buffer);
+        engine.main_loop(input[0], os);
+        os.flush();
+        ::close(output[1]);
+      });
+
+      const std::string request = "echo hello world\n";
+      const char eot = Engine::EOT;
+      char chunk[4096];
+      runner.run_each(name, [&]{
+        if(::write(input[1], request.data(), request.size()) < 0) return;
+        // EOT after the command, and after the response
+        for(size_t num_eots = 0; num_eots < 2; ) {
+          auto size = ::read(output[0], chunk, sizeof(chunk));
+          if(size <= 0) return;
+          num_eots += std::count(chunk, chunk + size, eot);
+        }
+      });
+
+      ::close(input[1]);
+      while(::read(output[0], chunk, sizeof(chunk)) > 0);
+      server.join();
+      ::close(input[0]);
+      ::close(output[0]);
+    };
+    run("round_trip/echo", nullptr);
+    run("round_trip/pipelined", "--pipelined");
+    run("round_trip/threaded", "--threaded");
+  }
+
+  void bench_logger(Runner& runner, const bfs::path& log_dir)
+  {
+    const auto run = [&](const std::string& name, size_t queue_size, LogLevel threshold){
+      if(!runner.selected(name)) return;
+      Logger logger;
+      logger.set_async(queue_size, LogOverflow::BLOCK);
+      logger.set_threshold(threshold);
+      if(!logger.open("bench.log", log_dir.string())) {
+        std::cerr << "failed to open the log in " << log_dir << '\n';
+        return;
+      }
+      size_t i = 0;
+      runner.run(name, [&]{
+        CLI_LOG(logger, INFO) << "Accept command: echo hello world " << ++i;
+      });
+      logger.close();
+    };
+    run("logger/sync", 0, LogLevel::DEBUG);
+    run("logger/async", 4096, LogLevel::DEBUG);
+    run("logger/filtered", 0, LogLevel::ERROR);
+  }
+
+}
+
+
+int main(int argc, const char* argv[])
+{
+  bpo::options_description options("Options");
+  options.add_options()
+    ("filter", bpo::value<std::string>()->default_value(""), "run benchmarks whose names contain the string")
+    ("min-time", bpo::value<double>()->default_value(0.2), "minimum measuring time of each benchmark in seconds")
+    ("json", bpo::value<std::string>(), "write results as JSON to the file")
+    ("log-dir", bpo::value<std::string>(), "directory for log files written by logger benchmarks [default = temporary]")
+    ("help", "show this help");
+  bpo::variables_map parsed;
+  try {
+    bpo::store(bpo::parse_command_line(argc, argv, options), parsed);
+    bpo::notify(parsed);
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << '\n' << options;
+    return EXIT_FAILURE;
+  }
+  if(parsed.count("help")) {
+    std::cout << options;
+    return EXIT_SUCCESS;
+  }
+
+  const auto min_time = std::chrono::duration<double>(parsed["min-time"].as<double>());
+  Runner runner(std::chrono::duration_cast<Runner::duration_type>(min_time), parsed["filter"].as<std::string>());
+
+  const bool temporary = !parsed.count("log-dir");
+  const auto log_dir = temporary ? bfs::temp_directory_path() / bfs::unique_path("cli_basic_engine_bench-%%%%%%%%")
+                                 : bfs::path(parsed["log-dir"].as<std::string>());
+
+  bench_command(runner);
+  bench_hash_map(runner);
+  bench_handle_command(runner);
+  bench_main_loop(runner);
+  bench_round_trip(runner);
+  bench_startup(runner);
+  bench_logger(runner, log_dir);
+  if(temporary) {
+    boost::system::error_code error;
+    bfs::remove_all(log_dir, error);
+  }
+
+  runner.report(std::cout);
+  if(parsed.count("json")) {
+    std::ofstream json(parsed["json"].as<std::string>());
+    runner.write_json(json);
+    if(!json) {
+      std::cerr << "failed to write " << parsed["json"].as<std::string>() << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
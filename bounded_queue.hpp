@@ -0,0 +1,136 @@
+/*!
+ * @file  bounded_queue.hpp
+ * @brief Bounded lock-free multi-producer multi-consumer queue
+ */
+#ifndef CLI_BASIC_ENGINE_BOUNDED_QUEUE_HPP
+#define CLI_BASIC_ENGINE_BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <boost/noncopyable.hpp>
+
+#include <cassert>
+#include <cstddef>
+
+
+namespace cli {
+
+  /*!
+   * @brief   Bounded queue whose slots are claimed by sequence numbers
+   * @tparam  T : type of elements (default constructible and movable)
+   * @note    Both push and pop fail instead of blocking. Based on the
+   *          bounded MPMC queue by Dmitry Vyukov.
+   * @code
+   * // Usage
+   * BoundedQueue<std::string> queue( 1024 );  // capacity must be a power of 2
+   * queue.try_push( "record" );
+   *
+   * std::string record;
+   * if( queue.try_pop(record) ) write( record );
+   * @endcode
+   */
+  template<class T>
+  class BoundedQueue : private boost::noncopyable {
+
+    public:
+    /*!
+     * @brief      Ctor.
+     * @param[in]  capacity : the number of slots, a power of 2
+     */
+    explicit BoundedQueue(size_t capacity)
+      : _slots(new Slot[capacity]), _mask(capacity - 1), _head(0), _tail(0)
+    {
+      assert(capacity >= 2 && (capacity & _mask) == 0);
+      for(size_t i = 0; i < capacity; ++i) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    //! Returns the number of slots
+    size_t capacity() const noexcept
+    {
+      return _mask + 1;
+    }
+
+    /*!
+     * @brief      Push an element if there is a free slot
+     * @retval     false : the queue is full, and the value is not moved
+     */
+    bool try_push(T&& value)
+    {
+      auto position = _tail.load(std::memory_order_relaxed);
+      for(;;) {
+        auto& slot = _slots[position & _mask];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+        if(diff == 0) {
+          if(_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            slot.value = std::move(value);
+            slot.sequence.store(position + 1, std::memory_order_release);
+            return true;
+          }
+        } else if(diff < 0) {
+          return false;
+        } else {
+          position = _tail.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /*!
+     * @brief      Pop the oldest element if any
+     * @retval     false : the queue is empty
+     */
+    bool try_pop(T& value)
+    {
+      auto position = _head.load(std::memory_order_relaxed);
+      for(;;) {
+        auto& slot = _slots[position & _mask];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+        if(diff == 0) {
+          if(_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            value = std::move(slot.value);
+            slot.sequence.store(position + _mask + 1, std::memory_order_release);
+            return true;
+          }
+        } else if(diff < 0) {
+          return false;
+        } else {
+          position = _head.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    //! Returns the number of pushed elements so far
+    size_t num_pushed() const noexcept
+    {
+      return _tail.load(std::memory_order_acquire);
+    }
+
+
+    private:
+    struct Slot {
+      std::atomic<size_t> sequence;
+      T                   value;
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    private:
+    std::unique_ptr<Slot[]> _slots;
+    const size_t            _mask;
+    // Padding rather than alignas keeps the indices on their own cache lines, since
+    // owners of the queue are allocated with operator new, which is not aligned in C++14
+    char                    _padding_head[CACHE_LINE];
+    std::atomic<size_t>     _head;
+    char                    _padding_tail[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t>     _tail;
+    char                    _padding_end[CACHE_LINE - sizeof(std::atomic<size_t>)];
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_BOUNDED_QUEUE_HPP */
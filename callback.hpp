@@ -5,7 +5,14 @@
 #ifndef CLI_BASIC_ENGINE_CALLBACK_HPP
 #define CLI_BASIC_ENGINE_CALLBACK_HPP
 
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
 #include <cassert>
+#include <cstddef>
+#include <cstring>
 
 
 namespace cli {
@@ -150,6 +157,210 @@ namespace cli {
 
   };
 
+
+  /*!
+   * @brief  Type-erased callback stored without heap allocation
+   * @note   Free functions, member functions bound to an instance, and function objects
+   *         such as capturing lambdas are stored in the inline buffer, and called through
+   *         a function pointer instead of a virtual function. Function objects larger than
+   *         INLINE_SIZE are rejected at compile time. CallbackFunction objects given by
+   *         std::unique_ptr are also accepted for compatibility; they keep their heap storage.
+   * @code
+   * // Usage
+   * class MyEngine {
+   *   void on_call( Command& );
+   * };
+   *
+   * MyEngine engine;
+   * Callback member( &engine, &MyEngine::on_call );
+   * Callback lambda( [&engine](Command& command){ engine.on_call(command); } );
+   *
+   * Command command;
+   * member( command );
+   * @endcode
+   */
+  class Callback {
+
+    template<class F>
+    using enable_if_callable = typename std::enable_if<
+      !std::is_same<typename std::decay<F>::type, Callback>::value &&
+      std::is_same<decltype(std::declval<typename std::decay<F>::type&>()(std::declval<Command&>())), void>::value
+    >::type;
+
+    public:
+    /*!
+     * @var    INLINE_SIZE
+     * @brief  Size of the inline buffer; a bound member function and a few captures fit in it
+     */
+    static constexpr size_t INLINE_SIZE = 4 * sizeof(void*);
+
+    //! Default ctor. makes an empty callback
+    Callback() noexcept
+      : _invoke(nullptr), _manage(nullptr)
+    {}
+
+    /*!
+     * @brief      Ctor. with a member function
+     * @param[in]  engine : pointer to the instance
+     * @param[in]  cbf    : pointer to the callback member function
+     */
+    template<class Engine>
+    Callback(Engine* const engine, void (Engine::*cbf)(Command&)) noexcept
+      : Callback(BoundMemberFunction<Engine>{ engine, cbf })
+    {
+      assert(engine != nullptr && cbf != nullptr);
+    }
+
+    /*!
+     * @brief      Ctor. with a function object or a pointer to a free function
+     * @param[in]  cbf : function object callable with Command&
+     */
+    template<class F, class = enable_if_callable<F>>
+    Callback(F&& cbf) noexcept(std::is_nothrow_constructible<typename std::decay<F>::type, F&&>::value)
+    {
+      store(std::forward<F>(cbf));
+    }
+
+    //! Ctor. with the abstract callback function wrapper
+    Callback(std::unique_ptr<CallbackFunction> cbf) noexcept
+      : Callback(OwnedFunction{ std::move(cbf) })
+    {}
+
+    //! Move ctor.
+    Callback(Callback&& other) noexcept
+      : _invoke(nullptr), _manage(nullptr)
+    {
+      move_from(other);
+    }
+
+    //! Move assignment
+    Callback& operator=(Callback&& other) noexcept
+    {
+      if(this != &other) {
+        reset();
+        move_from(other);
+      }
+      return *this;
+    }
+
+    Callback(const Callback&) = delete;
+    Callback& operator=(const Callback&) = delete;
+
+    //! dtor.
+    ~Callback() noexcept
+    {
+      reset();
+    }
+
+    //! Check the callback is set
+    explicit operator bool() const noexcept
+    {
+      return _invoke != nullptr;
+    }
+
+    //! Call operator
+    void operator()(Command& command) const
+    {
+      assert(_invoke != nullptr), _invoke(&_storage, command);
+    }
+
+
+    private:
+    enum struct Operation { MOVE, DESTROY };
+
+    using storage_type = typename std::aligned_storage<INLINE_SIZE, alignof(std::max_align_t)>::type;
+    using invoke_type  = void (*)(void*, Command&);
+    using manage_type  = void (*)(Operation, void*, void*);
+
+    template<class Engine>
+    struct BoundMemberFunction {
+      Engine* engine;
+      void (Engine::*function)(Command&);
+      void operator()(Command& command) const
+      {
+        (engine->*function)(command);
+      }
+    };
+
+    struct OwnedFunction {
+      std::unique_ptr<CallbackFunction> function;
+      void operator()(Command& command) const
+      {
+        (*function)(command);
+      }
+    };
+
+    template<class F>
+    static void invoke(void* storage, Command& command)
+    {
+      (*static_cast<F*>(storage))(command);
+    }
+
+    template<class F>
+    static void manage(Operation operation, void* destination, void* source) noexcept
+    {
+      if(operation == Operation::MOVE) {
+        new (destination) F(std::move(*static_cast<F*>(source)));
+      }
+      static_cast<F*>(source)->~F();
+    }
+
+    template<class F>
+    void store(F&& cbf)
+    {
+      using function_type = typename std::decay<F>::type;
+      static_assert(sizeof(function_type) <= INLINE_SIZE, "callback is too large to store inline");
+      static_assert(alignof(function_type) <= alignof(storage_type), "callback is over-aligned");
+      static_assert(std::is_nothrow_move_constructible<function_type>::value,
+                    "callback must be nothrow move constructible");
+      new (&_storage) function_type(std::forward<F>(cbf));
+      _invoke = &invoke<function_type>;
+      // Trivial function objects, e.g. function pointers, are moved by copying bytes
+      _manage = std::is_trivially_copyable<function_type>::value ? nullptr : &manage<function_type>;
+    }
+
+    void move_from(Callback& other) noexcept
+    {
+      if(other._manage) {
+        other._manage(Operation::MOVE, &_storage, &other._storage);
+      } else {
+        std::memcpy(&_storage, &other._storage, sizeof(_storage));
+      }
+      _invoke = other._invoke, _manage = other._manage;
+      other._invoke = nullptr, other._manage = nullptr;
+    }
+
+    void reset() noexcept
+    {
+      if(_manage) _manage(Operation::DESTROY, nullptr, &_storage);
+      _invoke = nullptr, _manage = nullptr;
+    }
+
+    private:
+    mutable storage_type _storage;
+    invoke_type          _invoke;
+    manage_type          _manage;
+
+  };
+
+
+  /*!
+   * @brief      Make a callback of the member function
+   * @param[in]  engine : pointer to the instance
+   * @param[in]  func   : pointer to the callback member function
+   */
+  template<class Engine>
+  Callback make_callback(Engine* engine, typename CallbackMemberFunction<Engine>::function_t func) noexcept
+  {
+    return Callback(engine, func);
+  }
+
+  //! Make a callback of the free function
+  inline Callback make_callback(CallbackStaticFunction::function_t func) noexcept
+  {
+    return Callback(func);
+  }
+
 }
 
 #endif  /* CLI_BASIC_ENGINE_CALLBACK_HPP */
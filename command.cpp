@@ -1,11 +1,80 @@
-#include <boost/algorithm/string.hpp>
-
 #include "command.hpp"
 #include "failure.hpp"
 
 
 using namespace cli;
 
+namespace {
+
+  inline bool is_space(char c) noexcept
+  {
+    return c == ' ' || ('\t' <= c && c <= '\r');
+  }
+
+  //! Relation between the number of arguments and the condition
+  enum struct Bound {
+    EQUAL, AT_LEAST, AT_MOST
+  };
+
+  bool satisfies(const Command& command, size_t num, Bound bound) noexcept
+  {
+    switch(bound) {
+      case Bound::AT_LEAST:
+        return command.num_arguments() >= num;
+      case Bound::AT_MOST:
+        return command.num_arguments() <= num;
+      default:
+        return command.num_arguments() == num;
+    }
+  }
+
+  //! Write the error message of the unsatisfied condition
+  void write_num_arguments_error(ResponseBuffer& stream, const Command& command,
+                                 size_t num, Bound bound, const char* detail)
+  {
+    const char* suffix = bound == Bound::AT_LEAST ? " at least"
+                       : bound == Bound::AT_MOST  ? " at most"
+                       : "";
+    stream << "Command '" << command.name_view() << "' requires ";
+    switch(num) {
+      case 0:
+        stream << "no argument";
+        break;
+      case 1:
+        stream << "1 argument" << suffix;
+        break;
+      default:
+        stream << num << " arguments" << suffix;
+    }
+
+    if(detail != nullptr) {
+      stream << ": " << detail;
+    }
+  }
+
+  void throw_if_unsatisfied(const Command& command, size_t num, Bound bound, const char* detail)
+  {
+    if(satisfies(command, num, bound)) return;
+
+    ResponseBuffer message;
+    write_num_arguments_error(message, command, num, bound, detail);
+    throw Failure(message.str());
+  }
+
+  bool fail_if_unsatisfied(Command& command, size_t num, Bound bound, const char* detail) noexcept
+  {
+    if(satisfies(command, num, bound)) return true;
+
+    try {
+      write_num_arguments_error(command.fail(), command, num, bound, detail);
+    } catch(...) {
+      // The command is marked as failed even if the message is not written
+    }
+    return false;
+  }
+
+}
+
 
 Command::Command(command_type command)
   : _raw_command( std::move(command) )
@@ -16,55 +85,93 @@ Command::Command(command_type command)
 
 Command::Command(Command&& command) noexcept
   : _raw_command( std::move(command._raw_command) ),
+    _tokens( command._tokens ),
+    _extra_tokens( std::move(command._extra_tokens) ),
+    _num_tokens( command._num_tokens ),
+    _response_stream( std::move(command._response_stream) ),
+    _failed( command._failed ),
+    _values( command._values ),
+    _extra_values( std::move(command._extra_values) ),
+    _scratch( command._scratch ),
     _name( std::move(command._name) ),
-    _arguments( std::move_if_noexcept(command._arguments) ),
-    _response_stream( std::move_if_noexcept(command._response_stream) )
+    _arguments( std::move(command._arguments) ),
+    _materialized( command._materialized )
 {
 }
 
 
 void Command::parse_raw_command()
 {
-  // Parse command to name and arguments
-  typename Command::container_type buffer;
-  boost::split( buffer, _raw_command, boost::is_space(), boost::algorithm::token_compress_on );
-  _name = std::move( buffer[0] );
-  _arguments.clear();
-  for( auto i = 1; i < buffer.size(); ++i )
+  // Split command to name and arguments, recording their positions only
+  _num_tokens = 0;
+  _extra_tokens.clear();
+  const auto size = _raw_command.size();
+  for( size_t i = 0; i < size; )
   {
-    _arguments.emplace_back( std::move(buffer[i]) );
+    if( is_space(_raw_command[i]) ) {
+      ++i;
+      continue;
+    }
+    const auto head = i;
+    while( i < size && !is_space(_raw_command[i]) ) ++i;
+    add_token({ static_cast<uint32_t>(head), static_cast<uint32_t>(i - head) });
   }
-  // Clear response stream
-  _response_stream.str("");
+  // Clear response stream and failure status
   _response_stream.clear();
+  _failed = false;
+  _materialized = false;
 }
 
 
-//--------------------------------------------------------
-void cli::check_num_arguments_equal( const Command& command,
-                                const size_t num,
-                                const char* detail ) noexcept(false)
+void Command::assign(const boost::string_ref* tokens, size_t num_tokens)
 {
-  if(command.num_arguments() == num) return;
-
-  Failure failure;
-  failure.response_stream() << "Command '" << command.name() << "' requires ";
-  switch(num) {
-    case 0:
-      failure.response_stream() << "no argument";
-      break;
-    case 1:
-      failure.response_stream() << "1 argument";
-      break;
-    default:
-      failure.response_stream() << num << " arguments";
+  // Join the tokens, recording their positions as they are
+  _num_tokens = 0;
+  _extra_tokens.clear();
+  _raw_command.clear();
+  for( size_t i = 0; i < num_tokens; ++i ) {
+    if( i > 0 ) _raw_command += ' ';
+    add_token({ static_cast<uint32_t>(_raw_command.size()), static_cast<uint32_t>(tokens[i].size()) });
+    _raw_command.append(tokens[i].data(), tokens[i].size());
   }
+  _response_stream.clear();
+  _failed = false;
+  _materialized = false;
+}
 
-  if(detail != nullptr) {
-    failure.response_stream() << ": " << detail;
+
+void Command::add_token(token_range range)
+{
+  if( _num_tokens <= INLINE_ARGUMENTS ) {
+    _tokens[_num_tokens] = range;
+  } else {
+    _extra_tokens.push_back(range);
   }
+  ++_num_tokens;
+}
 
-  throw failure;
+
+void Command::materialize() const
+{
+  if( _materialized ) return;
+  // Strings are only assigned so that their capacity is reused by the next commands
+  const auto view = name_view();
+  _name.assign(view.data(), view.size());
+  if( _arguments.size() < num_arguments() ) _arguments.resize(num_arguments());
+  for( size_t i = 0; i < num_arguments(); ++i ) {
+    const auto argument = argument_view(i);
+    _arguments[i].assign(argument.data(), argument.size());
+  }
+  _materialized = true;
+}
+
+
+//--------------------------------------------------------
+void cli::check_num_arguments_equal( const Command& command,
+                                     const size_t num,
+                                     const char* detail ) noexcept(false)
+{
+  throw_if_unsatisfied(command, num, Bound::EQUAL, detail);
 }
 
 
@@ -72,26 +179,7 @@ void cli::check_num_arguments_at_least( const Command& command,
                                         const size_t num,
                                         const char* detail ) noexcept(false)
 {
-  if(command.num_arguments() >= num) return;
-
-  Failure failure;
-  failure.response_stream() << "Command '" << command.name() << "' requires ";
-  switch( num ) {
-    case 0:
-      failure.response_stream() << "no argument";
-      break;
-    case 1:
-      failure.response_stream() << "1 argument at least";
-      break;
-    default:
-      failure.response_stream() << num << " arguments at least";
-  }
-
-  if(detail != nullptr) {
-    failure.response_stream() << ": " << detail;
-  }
-
-  throw failure;
+  throw_if_unsatisfied(command, num, Bound::AT_LEAST, detail);
 }
 
 
@@ -99,25 +187,32 @@ void cli::check_num_arguments_at_most( const Command& command,
                                        const size_t num,
                                        const char* detail ) noexcept(false)
 {
-  if(command.num_arguments() <= num ) return;
+  throw_if_unsatisfied(command, num, Bound::AT_MOST, detail);
+}
 
-  Failure failure;
-  failure.response_stream() << "Command '" << command.name() << "' requires ";
-  switch( num )
-  {
-    case 0:
-      failure.response_stream() << "no argument";
-      break;
-    case 1:
-      failure.response_stream() << "1 argument at most";
-      break;
-    default:
-      failure.response_stream() << num << " arguments at most";
-  }
 
-  if(detail != nullptr){
-    failure.response_stream() << ": " << detail;
-  }
+bool cli::check_num_arguments_equal( Command& command,
+                                     const size_t num,
+                                     const std::nothrow_t&,
+                                     const char* detail ) noexcept
+{
+  return fail_if_unsatisfied(command, num, Bound::EQUAL, detail);
+}
+
 
-  throw failure;
+bool cli::check_num_arguments_at_least( Command& command,
+                                        const size_t num,
+                                        const std::nothrow_t&,
+                                        const char* detail ) noexcept
+{
+  return fail_if_unsatisfied(command, num, Bound::AT_LEAST, detail);
+}
+
+
+bool cli::check_num_arguments_at_most( Command& command,
+                                       const size_t num,
+                                       const std::nothrow_t&,
+                                       const char* detail ) noexcept
+{
+  return fail_if_unsatisfied(command, num, Bound::AT_MOST, detail);
 }
@@ -5,15 +5,59 @@
 #ifndef CLI_BASIC_ENGINE_COMMAND_HPP
 #define CLI_BASIC_ENGINE_COMMAND_HPP
 
-#include <sstream>
+#include <array>
+#include <new>
+#include <string>
 #include <vector>
+#include <boost/utility/string_ref.hpp>
 
 #include <cstdint>
 #include <cassert>
 
+#include "arena.hpp"
+#include "response_buffer.hpp"
+
 
 namespace cli {
 
+  class ArgumentSchema;
+
+  /*!
+   * @brief  View of a token in the command line
+   * @note   It converts implicitly to std::string, and it copies the token only
+   *         when it converts.
+   * @code
+   * // Usage
+   * if( command.name_view() == "echo" ) { ... }        // no copy
+   * std::string key = command.argument_view(0);        // copy
+   * @endcode
+   */
+  class ArgumentView : public boost::string_ref {
+
+    public:
+    //! Default ctor. makes an empty view
+    ArgumentView() noexcept = default;
+
+    //! Ctor. with a view
+    ArgumentView(boost::string_ref view) noexcept
+      : boost::string_ref(view)
+    {
+    }
+
+    //! Ctor. with characters
+    ArgumentView(const char* data, size_t size) noexcept
+      : boost::string_ref(data, size)
+    {
+    }
+
+    //! Copy the token
+    operator std::string() const
+    {
+      return to_string();
+    }
+
+  };
+
   /*!
    * @brief  Parsed command & response holder
    * @code
@@ -33,6 +77,13 @@ namespace cli {
    * // add response
    * command.response_stream() << "Response message";
    * assert( command.response(), "Response message" );
+   *
+   * // report failure without exception
+   * command.fail() << "Error message";
+   * assert( command.failed() );
+   *
+   * // scratch memory released after the response is written
+   * auto words = command.scratch().allocate<boost::string_ref>( command.num_arguments() );
    * @endcode
    */
   class Command {
@@ -50,9 +101,14 @@ namespace cli {
     using argument_type = std::string;
     /*!
      * @typedef  container_type
-     * @brief    Container for arguments
+     * @brief    Type of argument container
      */
     using container_type = std::vector<argument_type>;
+    /*!
+     * @typedef  view_type
+     * @brief    Type of views of the name and arguments into the raw command string
+     */
+    using view_type = ArgumentView;
     /*!
      * @typedef  response_type
      * @brief    Type of response
@@ -62,7 +118,13 @@ namespace cli {
      * @typedef  stream_type
      * @brief    Type of response stream
      */
-    using stream_type = std::ostringstream;
+    using stream_type = ResponseBuffer;
+
+    /*!
+     * @var    INLINE_ARGUMENTS
+     * @brief  The number of arguments stored without heap allocation
+     */
+    static constexpr size_t INLINE_ARGUMENTS = 8;
 
 
     public:
@@ -87,17 +149,27 @@ namespace cli {
     /*!
      * @brief      Parse command from a raw string to name and arguments
      * @param[in]  command   : raw command string
-     * @note       It also clears response stream.
+     * @note       It also clears response stream and failure status.
+     *             The raw command string is copied into the reused internal storage.
      */
-    void parse(command_type command_line)
+    void parse(boost::string_ref command_line)
     {
-      _raw_command = std::move(command_line);  parse_raw_command();
+      _raw_command.assign(command_line.data(), command_line.size());  parse_raw_command();
     }
 
+    /*!
+     * @brief      Assign a pre-tokenized command without splitting it
+     * @param[in]  tokens     : the name followed by the arguments
+     * @param[in]  num_tokens : the number of the tokens
+     * @note       Tokens may contain white spaces. The raw command string is the tokens
+     *             joined by a space, and it also clears response stream and failure status.
+     */
+    void assign(const boost::string_ref* tokens, size_t num_tokens);
+
     //! Clear response stream
     void clear() noexcept
     {
-      _response_stream.clear();  _response_stream.str("");
+      _response_stream.clear();
     }
 
     //! Returns raw command string
@@ -106,29 +178,69 @@ namespace cli {
       return _raw_command;
     }
 
-    //! Returns command name (alias of the first argument)
-    const argument_type& name() const noexcept
+    /*!
+     * @brief   Returns command name (alias of the first argument)
+     * @note    The name and arguments are copied into storage reused by the command
+     *          when one of them is first accessed after parsing.
+     *          name_view() and argument_view() do not copy them.
+     */
+    const argument_type& name() const
     {
-      return _name;
+      return materialize(), _name;
+    }
+
+    //! Returns command name as a view into the raw command string
+    view_type name_view() const noexcept
+    {
+      return _num_tokens > 0 ? token(0) : view_type();
     }
 
     //! Returns the number of arguments
     size_t num_arguments() const noexcept
     {
-      return _arguments.size();
+      return _num_tokens > 0 ? _num_tokens - 1 : 0;
     }
 
     /*!
      * @brief      Returns the index-th argument as an argument_type
      * @param[in]  index : index value
      */
-    const argument_type& argument(size_t index) const noexcept
+    const argument_type& argument(size_t index) const
+    {
+      return assert(index < num_arguments()), materialize(), _arguments[index];
+    }
+
+    /*!
+     * @brief      Returns the index-th argument as a view into the raw command string
+     * @param[in]  index : index value
+     */
+    view_type argument_view(size_t index) const noexcept
+    {
+      return assert(index < num_arguments()), token(index + 1);
+    }
+
+    /*!
+     * @brief      Returns the index-th argument parsed as an integer
+     * @param[in]  index : index value
+     * @attention  It is available only for arguments declared as integers in the schema.
+     */
+    long long integer_argument(size_t index) const noexcept
+    {
+      return assert(index < num_arguments()), value(index).integer;
+    }
+
+    /*!
+     * @brief      Returns the index-th argument parsed as a real number
+     * @param[in]  index : index value
+     * @attention  It is available only for arguments declared as real numbers in the schema.
+     */
+    double real_argument(size_t index) const noexcept
     {
-      return assert(index < num_arguments()), _arguments[index];
+      return assert(index < num_arguments()), value(index).real;
     }
 
     //! Returns response
-    response_type response() const
+    const response_type& response() const noexcept
     {
       return _response_stream.str();
     }
@@ -139,15 +251,117 @@ namespace cli {
       return _response_stream;
     }
 
+    /*!
+     * @brief   Mark the command as failed
+     * @return  cleared response stream to write the error message
+     * @note    The engine responds with '?' after the callback returns,
+     *          as if Failure was thrown, but without unwinding.
+     */
+    stream_type& fail() noexcept
+    {
+      _failed = true;
+      _response_stream.clear();
+      return _response_stream;
+    }
+
+    //! Check the command is marked as failed
+    bool failed() const noexcept
+    {
+      return _failed;
+    }
+
+    /*!
+     * @brief   Returns the arena for scratch memory of the callback
+     * @note    The engine resets it after writing the response, so memory from it
+     *          must not be kept beyond the callback.
+     * @attention  It is available only while the command is handled by the engine,
+     *             or after set_scratch().
+     */
+    Arena& scratch() const noexcept
+    {
+      return assert(_scratch != nullptr), *_scratch;
+    }
+
+    //! Check an arena is bound for scratch memory
+    bool has_scratch() const noexcept
+    {
+      return _scratch != nullptr;
+    }
+
+    /*!
+     * @brief      Bind the arena for scratch memory
+     * @param[in]  arena : arena outliving the binding, or nullptr to unbind
+     */
+    void set_scratch(Arena* arena) noexcept
+    {
+      _scratch = arena;
+    }
+
 
     private:
+    friend class ArgumentSchema;
+
+    //! Token position in the raw command string
+    struct token_range {
+      uint32_t offset;
+      uint32_t length;
+    };
+
+    //! Argument value parsed by the schema
+    union argument_value {
+      long long integer;
+      double    real;
+    };
+
     void parse_raw_command();
+    void add_token(token_range range);
+    void materialize() const;
+
+    const argument_value& value(size_t index) const noexcept
+    {
+      return index < INLINE_ARGUMENTS ? _values[index] : _extra_values[index - INLINE_ARGUMENTS];
+    }
+
+    argument_value& value(size_t index)
+    {
+      if(index < INLINE_ARGUMENTS) return _values[index];
+      if(_extra_values.size() <= index - INLINE_ARGUMENTS) _extra_values.resize(index - INLINE_ARGUMENTS + 1);
+      return _extra_values[index - INLINE_ARGUMENTS];
+    }
+
+    void set_integer_argument(size_t index, long long value)
+    {
+      this->value(index).integer = value;
+    }
+
+    void set_real_argument(size_t index, double value)
+    {
+      this->value(index).real = value;
+    }
+
+    view_type token(size_t index) const noexcept
+    {
+      const auto& range = index <= INLINE_ARGUMENTS ? _tokens[index]
+                                                    : _extra_tokens[index - INLINE_ARGUMENTS - 1];
+      return view_type(_raw_command.data() + range.offset, range.length);
+    }
 
     private:
     command_type   _raw_command;
-    argument_type  _name;
-    container_type _arguments;
+    // name and the first INLINE_ARGUMENTS arguments, followed by the others
+    std::array<token_range, INLINE_ARGUMENTS + 1> _tokens;
+    std::vector<token_range>                      _extra_tokens;
+    size_t         _num_tokens = 0;
     stream_type    _response_stream;
+    bool           _failed = false;
+    // values of the arguments parsed by the schema
+    std::array<argument_value, INLINE_ARGUMENTS> _values;
+    std::vector<argument_value>                  _extra_values;
+    Arena*         _scratch = nullptr;
+    // copies of the name and arguments, made on the first access to them
+    mutable argument_type  _name;
+    mutable container_type _arguments;
+    mutable bool           _materialized = false;
 
   };
 
@@ -179,6 +393,26 @@ namespace cli {
    */
   void check_num_arguments_at_most(const Command& command, size_t num, const char* detail = nullptr) noexcept(false);
 
+  /*!
+   * @brief      Non-throwing versions of the checks above
+   * @param[in]  command : checked command object
+   * @param[in]  num     : condition
+   * @param[in]  detail  : additional description for the error
+   * @retval     true  : the condition is satisfied
+   * @retval     false : the condition is not satisfied, and the command is marked as failed
+   *                     with the same message as Failure
+   * @code
+   * void on_call( Command& command )
+   * {
+   *   if( !check_num_arguments_equal(command, 1, std::nothrow) ) return;
+   *   ...
+   * }
+   * @endcode
+   */
+  bool check_num_arguments_equal(Command& command, size_t num, const std::nothrow_t&, const char* detail = nullptr) noexcept;
+  bool check_num_arguments_at_least(Command& command, size_t num, const std::nothrow_t&, const char* detail = nullptr) noexcept;
+  bool check_num_arguments_at_most(Command& command, size_t num, const std::nothrow_t&, const char* detail = nullptr) noexcept;
+
 }
 
 #endif  /* CLI_BASIC_ENGINE_COMMAND_HPP */
@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include <boost/program_options.hpp>
-#include <boost/format.hpp>
-#include <boost/algorithm/string/trim.hpp>
+
+#include <cstring>
 
 
 #include "engine.hpp"
+#include "line_reader.hpp"
+#include "mapped_file.hpp"
+#include "server.hpp"
+#include "session_record.hpp"
+#include "spsc_ring.hpp"
+#include "worker_pool.hpp"
 #include "command.hpp"
 #include "callback.hpp"
 #include "failure.hpp"
@@ -14,54 +24,149 @@ namespace bpo = boost::program_options;
 
 namespace {
 
-  template<class E>
-  std::unique_ptr<CallbackFunction> make_callback(E* engine,
-                                                  typename CallbackMemberFunction<E>::function_t func)
+  // The maximum number of commands handled in a batch of the pipelined loop
+  constexpr size_t MAX_BATCH_SIZE = 256;
+
+  // The number of commands in flight between the stages of the threaded loop
+  constexpr size_t NUM_STAGE_SLOTS = 1024;
+  // Interval to check the reader stage is stopped while the input is idle
+  constexpr int    STAGE_READ_TIMEOUT = 10;  // ms
+  // Idle stages yield this many times, and then sleep between checks
+  constexpr unsigned STAGE_SPIN_LIMIT = 1000;
+  constexpr auto     STAGE_IDLE_SLEEP = std::chrono::microseconds(100);
+
+  // Head of progress lines of jobs
+  constexpr char PROGRESS = '~';
+
+  constexpr char MALFORMED_REQUEST[] = "malformed request";
+  constexpr char OVERSIZED_REQUEST[] = "request frame too large";
+  constexpr char OVERSIZED_LINE[] = "line too long";
+
+  // Partial lines and frames of a session are buffered up to this size, while
+  // files and stdin take frames up to frame::MAX_PAYLOAD_SIZE
+  constexpr size_t MAX_SESSION_INPUT_SIZE = 1 << 20;
+
+  //! Check the request frame at the head of the buffer exceeds the limit
+  bool oversized_frame(const LineReader& reader, size_t limit = frame::MAX_PAYLOAD_SIZE) noexcept
   {
-    return std::unique_ptr<CallbackFunction>(new CallbackMemberFunction<E>(engine, func));
+    const auto buffered = reader.peek();
+    return buffered.size() >= frame::HEADER_SIZE && frame::payload_size(buffered.data()) > limit;
   }
 
-  Command read_command(std::istream& is, std::ostream& os)
+  //! Check a complete request frame is buffered
+  bool frame_buffered(const LineReader& reader) noexcept
   {
-    static auto is_valid_command = [](const std::string& str){
-      return str.size() > 0 && str[0] != '#';
-    };
-    std::string buffer;
-    do {
-      os << "> ";
-    } while( std::getline(is, buffer) && !is_valid_command(buffer) );
-    os << Engine::EOT << std::flush;
-    boost::trim_if(buffer, boost::is_space());
-    return Command(buffer);
+    const auto buffered = reader.peek();
+    return buffered.size() >= frame::HEADER_SIZE &&
+           buffered.size() - frame::HEADER_SIZE >= frame::payload_size(buffered.data());
+  }
+
+  //! Take the payload of the next request frame from the buffer
+  bool take_frame(LineReader& reader, LineReader::line_type& payload) noexcept
+  {
+    LineReader::line_type header;
+    if(!frame_buffered(reader)) return false;
+    reader.next_buffered_bytes(frame::HEADER_SIZE, header);
+    return reader.next_buffered_bytes(frame::payload_size(header.data()), payload);
+  }
+
+  /*!
+   * @brief      Read the payload of the next request frame
+   * @retval     false : the input reached the end
+   */
+  bool read_frame(LineReader& reader, LineReader::line_type& payload)
+  {
+    LineReader::line_type header;
+    if(!reader.next_bytes(frame::HEADER_SIZE, header)) return false;
+    return reader.next_bytes(frame::payload_size(header.data()), payload);
+  }
+
+  //! Assign the tokens of the request to the command; returns false if it is malformed
+  bool assign_request(Command& command, LineReader::line_type payload, std::vector<boost::string_ref>& tokens)
+  {
+    if(!frame::decode_request(payload, tokens) || tokens.empty()) return false;
+    command.assign(tokens.data(), tokens.size());
+    return true;
+  }
+
+  //! Wait for the condition of another stage, yielding and then sleeping
+  template<class Condition>
+  void wait_stage(Condition condition)
+  {
+    for(unsigned i = 0; !condition(); ++i) {
+      if(i < STAGE_SPIN_LIMIT) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(STAGE_IDLE_SLEEP);
+      }
+    }
+  }
+
+  //! Write the progress lines made by a step of a job
+  void write_progress(std::ostream& os, ResponseBuffer& progress)
+  {
+    boost::string_ref lines(progress.str());
+    while( !lines.empty() ) {
+      const auto end = lines.find('\n');
+      const auto line = lines.substr(0, end);
+      os.put(PROGRESS).put(' ').write(line.data(), line.size()).put('\n');
+      if(end == boost::string_ref::npos) break;
+      lines.remove_prefix(end + 1);
+    }
+    progress.clear();
   }
 
+  void write_prompts(std::ostream& os, size_t num)
+  {
+    for(size_t i = 0; i < num; ++i) os << "> ";
+  }
+
+  //! Command read ahead in the pipelined loop
+  struct PendingCommand {
+    Command command;
+    size_t  num_prompts;  // prompts not written yet before the command
+    Arena   scratch;      // commands of a batch run in parallel, so each has its own
+    SessionRecorder::clock_type::time_point received;
+  };
+
 }
 
 
 // Public interface
 //--------------------------------------------------------
 Engine::Engine()
-  : _quit_flag(false),
+  : _stats_enabled(false),
+    _server(nullptr),
+    _quit_flag(false),
+    _protocol(Protocol::TEXT),
+    _requested_protocol(Protocol::TEXT),
     _options("Options for CTI Engine")
 {
-  // Register options
-  options().add_options()
-    ("disable-logging", "Disable logging")
-    ("log-file", bpo::value<std::string>()->default_value(Logger::DEFAULT_LOG_FILENAME), "Set log file")
-    ("log-dir", bpo::value<std::string>()->default_value(Logger::DEFAULT_LOG_DIR), "Set log dir")
-    ("help", "Show help")
-  ;
-
   // Register commands
   register_callback("echo",
                     make_callback(this, &Engine::echo_command),
-                    "Echo test");
+                    "Echo test",
+                    CallbackAttribute::CONCURRENT);
   register_callback("list_commands",
                     make_callback(this, &Engine::list_commands_command),
-                    "List registered commands");
+                    "List registered commands",
+                    CallbackAttribute::CONCURRENT | CallbackAttribute::CACHEABLE);
   register_callback("help",
                     make_callback(this, &Engine::help_command),
-                    "Show help");
+                    "Show help",
+                    CallbackAttribute::CONCURRENT | CallbackAttribute::CACHEABLE);
+  register_callback("protocol",
+                    make_callback(this, &Engine::protocol_command),
+                    ArgumentSchema().string("name"),
+                    "Switch the framing to 'text' or 'binary'");
+  register_callback("stats",
+                    make_callback(this, &Engine::stats_command),
+                    ArgumentSchema().string("reset").optional(),
+                    "Show latency percentiles of each command, or clear them with 'reset'");
+  register_callback("cancel",
+                    make_callback(this, &Engine::cancel_command),
+                    ArgumentSchema().string("name").optional(),
+                    "Cancel the running jobs, or the ones of the command");
   register_callback("quit",
                     make_callback(this, &Engine::quit_command),
                     "Quit the application");
@@ -78,10 +183,15 @@ void Engine::initialize(int argc, const char* argv[])
 {
   // Parse program options (throwable)
   {
-    bpo::store( bpo::parse_command_line(argc,argv,_options), _parsed_options );
+    bpo::store( bpo::parse_command_line(argc,argv,options()), _parsed_options );
     bpo::notify( _parsed_options );
   }
 
+  _response_cache.set_capacity( parsed_options()["cache-size"].as<size_t>() );
+  if( parsed_options().count("stats") ) {
+    enable_stats();
+  }
+
   // Handle help option
   if( parsed_options().count("help") ) {
     std::cout << options() << std::endl;
@@ -91,55 +201,738 @@ void Engine::initialize(int argc, const char* argv[])
 
 
 int Engine::main_loop(std::istream& is, std::ostream& os)
+{
+  // A tied output stream would be flushed on every read of the input; instead
+  // the loops flush the prompt before they block
+  if(is.tie() != nullptr) is.tie()->flush();
+  auto tied = is.tie(nullptr);
+  LineReader reader(is.rdbuf());
+  auto result = main_loop(reader, os);
+  is.tie(tied);
+  return result;
+}
+
+
+int Engine::main_loop(int fd, std::ostream& os)
+{
+  LineReader reader(fd);
+  return main_loop(reader, os);
+}
+
+
+int Engine::serve(const std::string& socket_path)
 {
   if(_quit_flag) return EXIT_SUCCESS;  // for help
 
+  if(!open_log() || !open_record()) return EXIT_FAILURE;
+  open_trace();
+
+  try {
+    Server server(socket_path);
+    CLI_LOG(logger(), INFO) << "Serve on " << socket_path;
+    Command command;
+    command.response_stream().exchange( _response_pool.acquire() );
+    command.set_scratch( &_arena );
+    _server = &server;
+    server.run( [](Session& session){ session.output() << "> "; },
+                [&](Session& session){ serve_input(session, command); },
+                [&](const std::system_error& e){ CLI_LOG(logger(), WARNING) << "Cannot accept clients: " << e.what(); } );
+    _server = nullptr;
+    _response_pool.release( command.response_stream().exchange({}) );
+  } catch( const std::exception& e ) {
+    _server = nullptr;
+    _recorder.reset();
+    close_trace();
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  _recorder.reset();
+  close_trace();
+  return EXIT_SUCCESS;
+}
+
+
+int Engine::replay(const std::string& path, std::ostream& os)
+{
+  using clock_type = std::chrono::steady_clock;
+
+  if(_quit_flag) return EXIT_SUCCESS;  // for help
+
+  const auto& pacing = parsed_options()["replay-pacing"].as<std::string>();
+  if(pacing != "fast" && pacing != "original") {
+    std::cerr << "unknown replay pacing: " << pacing << std::endl;
+    return EXIT_FAILURE;
+  }
   if(!open_log()) return EXIT_FAILURE;
+  const bool paced = pacing == "original";
 
+  // Maximum number of mismatches reported in detail
+  constexpr size_t MAX_REPORTED_MISMATCHES = 10;
+
+  size_t num_mismatches = 0;
+  std::vector<uint64_t> latencies;
+  clock_type::duration elapsed(0);
   try {
-    while( !_quit_flag ){
-      Command command = read_command( is, os );
-      handle_command( command, os );
+    SessionReader reader(path);
+    std::ostream discarded(nullptr);
+    Command command;
+    command.response_stream().exchange( _response_pool.acquire() );
+    command.set_scratch( &_arena );
+
+    SessionRecord record;
+    const auto start = clock_type::now();
+    while( reader.next(record) ) {
+      if(paced) {
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.time));
+      }
+      const auto begin = clock_type::now();
+      command.parse(record.command);
+      const auto result = execute_command(command);
+      respond(command, result, discarded, begin);
+      latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - begin).count());
+      _quit_flag = false;
+
+      const auto& response = command.response();
+      if(response_status(result) != record.status || response.size() != record.response_size ||
+         hash_response(response) != record.response_hash) {
+        if(++num_mismatches <= MAX_REPORTED_MISMATCHES) {
+          os << "mismatch at command " << latencies.size() << ": " << record.command << '\n';
+        }
+      }
     }
+    elapsed = clock_type::now() - start;
+    _response_pool.release( command.response_stream().exchange({}) );
   } catch( const std::exception& e ) {
     std::cerr << e.what() << std::endl;
     return EXIT_FAILURE;
   }
 
-  return EXIT_SUCCESS;
+  // Report
+  const auto seconds = std::chrono::duration<double>(elapsed).count();
+  std::sort(latencies.begin(), latencies.end());
+  const auto percentile = [&](double ratio) -> uint64_t {
+    if(latencies.empty()) return 0;
+    return latencies[std::min(latencies.size() - 1, static_cast<size_t>(ratio * static_cast<double>(latencies.size())))];
+  };
+  os << "replayed " << latencies.size() << " commands in " << seconds << " s ("
+     << (seconds > 0 ? static_cast<double>(latencies.size()) / seconds : 0.0) << " commands/s)\n"
+     << "latency [ns]: p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+     << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999)
+     << ", max " << (latencies.empty() ? 0 : latencies.back()) << '\n'
+     << "mismatched responses: " << num_mismatches << std::endl;
+  return num_mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+int Engine::run_script(const std::string& path, std::ostream& os)
+{
+  if(_quit_flag) return EXIT_SUCCESS;  // for help
+
+  if(!open_log() || !open_record()) return EXIT_FAILURE;
+  open_trace();
+
+  bool failed = false;
+  try {
+    MappedFile file(path);
+    std::ostream discarded(nullptr);
+    auto& output = parsed_options().count("quiet") ? discarded : os;
+    Command command;
+    command.response_stream().exchange( _response_pool.acquire() );
+    command.set_scratch( &_arena );
+
+    _protocol = _requested_protocol = Protocol::TEXT;
+    const auto data = file.data();
+    size_t offset = 0;
+    while( !_quit_flag && offset < data.size() ) {
+      // Lines are views into the mapping; the command copies the line only
+      auto found = static_cast<const char*>(std::memchr(data.data() + offset, '\n', data.size() - offset));
+      const auto end = found != nullptr ? static_cast<size_t>(found - data.data()) : data.size();
+      const auto line = data.substr(offset, end - offset);
+      offset = end + 1;
+      if( !is_command_line(line) ) continue;
+
+      const auto received = received_time();
+      command.parse(trim_line(line));
+      const auto result = execute_command(command);
+      respond(command, result, output, received);
+      failed |= result != Result::ACCEPTED;
+      file.release(offset);
+    }
+    _response_pool.release( command.response_stream().exchange({}) );
+  } catch( const std::exception& e ) {
+    std::cerr << e.what() << std::endl;
+    failed = true;
+  }
+
+  os.flush();
+  _recorder.reset();
+  close_trace();
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+void Engine::stop() noexcept
+{
+  if(auto server = _server.load()) server->stop();
 }
 
 
 // Protected interface
 //--------------------------------------------------------
 bool Engine::is_registered(const std::string& command) const noexcept
+{
+  return find_callback(command) != nullptr;
+}
+
+
+void Engine::register_callback(std::string command,
+                               Callback cbf,
+                               std::string help,
+                               CallbackAttribute attributes) noexcept
+{
+  add_callback(std::move(command),
+               CallbackEntry{ std::move(cbf), std::move(help), attributes, boost::none, nullptr, JobFactory() });
+}
+
+
+void Engine::register_callback(std::string command,
+                               Callback cbf,
+                               ArgumentSchema schema,
+                               std::string help,
+                               CallbackAttribute attributes) noexcept
+{
+  add_callback(std::move(command),
+               CallbackEntry{ std::move(cbf), std::move(help), attributes, std::move(schema), nullptr, JobFactory() });
+}
+
+
+void Engine::register_job(std::string command,
+                          JobFactory factory,
+                          std::string help,
+                          CallbackAttribute attributes) noexcept
+{
+  add_callback(std::move(command),
+               CallbackEntry{ Callback(), std::move(help), attributes, boost::none, nullptr, std::move(factory) });
+}
+
+
+void Engine::register_job(std::string command,
+                          JobFactory factory,
+                          ArgumentSchema schema,
+                          std::string help,
+                          CallbackAttribute attributes) noexcept
+{
+  add_callback(std::move(command),
+               CallbackEntry{ Callback(), std::move(help), attributes, std::move(schema), nullptr, std::move(factory) });
+}
+
+
+bool Engine::remove_callback(const std::string& command){
+  // The registry is a part of responses of list_commands and help
+  _response_cache.invalidate();
+  return _callback_list.erase(command) > 0;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+auto Engine::find_callback(boost::string_ref command) const noexcept -> const CallbackEntry*
 {
   auto ite = _callback_list.find(command);
-  return ite != _callback_list.end();
+  return ite != _callback_list.end() ? &ite->second : nullptr;
 }
 
 
-void Engine::register_callback(std::string command, std::unique_ptr<CallbackFunction> cbf, std::string help) noexcept
+void Engine::add_callback(std::string command, CallbackEntry entry)
 {
+  _response_cache.invalidate();
   auto ite = _callback_list.find(command);
   if( ite != _callback_list.end() ) {
     _callback_list.erase(ite);
-    _help_list.erase(_help_list.find(command));
   }
-  _callback_list.emplace(command, std::move(cbf));
-  _help_list.emplace(std::move(command), std::move(help));
+  if(_stats_enabled) entry.stats.reset(new CallbackStats);
+  _callback_list.emplace(std::move(command), std::move(entry));
 }
 
 
-bool Engine::remove_callback(const std::string& command){
-  if( !is_registered(command) ) return false;
-  auto i = _callback_list.erase(command) & _help_list.erase(command);
-  return i > 0;
+int Engine::main_loop(LineReader& reader, std::ostream& os)
+{
+  if(_quit_flag) return EXIT_SUCCESS;  // for help
+
+  if(!open_log() || !open_record()) return EXIT_FAILURE;
+  open_trace();
+
+  int result = EXIT_SUCCESS;
+  try {
+    // Each loop returns when the input ends, or after the command switching the protocol
+    _protocol = _requested_protocol = Protocol::TEXT;
+    do {
+      _protocol = _requested_protocol;
+      if(_protocol == Protocol::BINARY) {
+        binary_loop( reader, os );
+      } else if(parsed_options().count("threaded") && reader.waitable()) {
+        // The reader thread has to be stopped on quit, which needs a source to poll
+        threaded_loop( reader, os );
+      } else if(parsed_options().count("pipelined")) {
+        pipelined_loop( reader, os );
+      } else {
+        text_loop( reader, os );
+      }
+    } while( !_quit_flag && _requested_protocol != _protocol );
+  } catch( const std::exception& e ) {
+    std::cerr << e.what() << std::endl;
+    result = EXIT_FAILURE;
+  }
+
+  os.flush();
+  _recorder.reset();
+  close_trace();
+  return result;
+}
+
+
+void Engine::text_loop(LineReader& reader, std::ostream& os)
+{
+  Command command;
+  command.response_stream().exchange( _response_pool.acquire() );
+  command.set_scratch( &_arena );
+  while( !_quit_flag && _requested_protocol == _protocol ) {
+    LineReader::line_type line;
+    bool available = false;
+    bool taken = false;
+    // Jobs make a step between commands, and keep running while no complete line is available
+    if( !_jobs.empty() ) {
+      resume_jobs(os);
+      if( _jobs.empty() ) continue;
+      TraceSpan span(_tracer, "read");
+      if( reader.waitable() ) {
+        available = reader.next_available(line);
+        if( !available && !reader.eof() ) continue;
+      } else {
+        // A stream buffer cannot tell whether reading blocks, e.g. std::cin synced
+        // with stdio, so a line is read after each step to take 'cancel' and 'quit'
+        available = reader.next(line);
+      }
+      taken = true;
+    }
+
+    // Output after a running job is held until its response
+    auto& out = _jobs.empty() ? os : static_cast<std::ostream&>(_jobs.back().backlog);
+    out << "> ";
+    if( !taken ) {
+      // The prompt is shown before waiting for input
+      if( &out == &os && !reader.buffered() ) os.flush();
+      TraceSpan span(_tracer, "read");
+      available = reader.next(line);
+    }
+    if( available && !is_command_line(line) ) continue;
+    const auto received = received_time();
+    out << EOT;
+    if( &out == &os ) os.flush();
+    if( !available ) break;
+
+    const CallbackEntry* handler;
+    {
+      TraceSpan span(_tracer, "parse");
+      command.parse(trim_line(line));
+    }
+    {
+      TraceSpan span(_tracer, "lookup");
+      handler = find_callback(command.name_view());
+    }
+    if( handler && handler->job ) {
+      start_job( *handler, command, out, received );
+    } else {
+      respond( command, execute_callback(handler, command), out, received );
+    }
+    os.flush();
+  }
+
+  // Jobs run to completion at the end of input, and they are cancelled on quit
+  // or switching the protocol
+  while( !_jobs.empty() ) {
+    if( _quit_flag || _requested_protocol != _protocol ) {
+      for(auto& job : _jobs) job.cancelled = true;
+    }
+    resume_jobs(os);
+  }
+  os.flush();
+  _response_pool.release( command.response_stream().exchange({}) );
+}
+
+
+void Engine::pipelined_loop(LineReader& reader, std::ostream& os)
+{
+  // Commands readable without blocking are read ahead into a batch, which ends
+  // at a barrier (non-concurrent) command. Prompts are written just before the
+  // response of each command, so the output is the same as the serial loop.
+  std::unique_ptr<WorkerPool> workers;
+  if(auto num_workers = parsed_options()["workers"].as<size_t>()) {
+    workers.reset(new WorkerPool(num_workers));
+  }
+
+  std::vector<PendingCommand> batch;
+  std::vector<Result>         results;
+  size_t num_prompts = 0;
+  bool   end_of_input = false;
+
+  while( !_quit_flag && !end_of_input && _requested_protocol == _protocol ) {
+    // Read ahead
+    size_t size = 0;
+    bool barrier = false;
+    LineReader::line_type line;
+    while( size < MAX_BATCH_SIZE && !barrier ) {
+      ++num_prompts;
+      bool available;
+      if(size == 0) {
+        // Nothing to respond; block on the input
+        write_prompts(os, num_prompts);
+        num_prompts = 0;
+        if(!reader.buffered()) os.flush();
+        TraceSpan span(_tracer, "read");
+        available = reader.next(line);
+      } else {
+        TraceSpan span(_tracer, "read");
+        available = reader.next_available(line);
+        if(!available && !reader.eof()) {
+          --num_prompts;
+          break;
+        }
+      }
+      if(!available) {
+        end_of_input = true;
+        break;
+      }
+      if(!is_command_line(line)) continue;
+
+      if(size == batch.size()) {
+        batch.emplace_back();
+        batch.back().command.response_stream().exchange( _response_pool.acquire() );
+      }
+      auto& pending = batch[size++];
+      {
+        TraceSpan span(_tracer, "parse");
+        pending.command.parse(trim_line(line));
+      }
+      pending.num_prompts = num_prompts;
+      pending.received = received_time();
+      num_prompts = 0;
+      auto handler = find_callback(pending.command.name_view());
+      barrier = handler && !has_attribute(handler->attributes, CallbackAttribute::CONCURRENT);
+    }
+
+    // Execute concurrent commands in parallel, and then the barrier
+    results.resize(size);
+    auto num_concurrent = barrier ? size - 1 : size;
+    auto execute = [&](size_t i){
+      // Bound here since the growth of the batch moves the arenas
+      batch[i].command.set_scratch(&batch[i].scratch);
+      results[i] = execute_command(batch[i].command);
+    };
+    if(workers) {
+      workers->parallel_for(num_concurrent, execute);
+    } else {
+      for(size_t i = 0; i < num_concurrent; ++i) execute(i);
+    }
+    // The serial loop would have stopped at an aborted command before the barrier
+    const auto aborted = std::any_of(results.begin(), results.begin() + num_concurrent,
+                                     [](Result result){ return result == Result::ABORTED; });
+    if(barrier && !aborted) execute(size - 1);
+
+    // Respond in the input order, as far as the first aborted command
+    for(size_t i = 0; i < size; ++i) {
+      write_prompts(os, batch[i].num_prompts);
+      os << EOT;
+      respond(batch[i].command, results[i], os, batch[i].received);
+      if(results[i] == Result::ABORTED) break;
+    }
+  }
+
+  if(end_of_input && !_quit_flag) {
+    write_prompts(os, num_prompts);
+    os << EOT;
+  }
+
+  for(auto& pending : batch) {
+    _response_pool.release( pending.command.response_stream().exchange({}) );
+  }
+}
+
+
+void Engine::threaded_loop(LineReader& reader, std::ostream& os)
+{
+  // The reader thread parses commands into slots, the calling thread executes them,
+  // and the writer thread responds. Indices of the slots circulate through the rings
+  // from free_slots to parsed, executed, and back to free_slots.
+  enum struct Mark {
+    COMMAND,
+    QUIT,          // the command quits; the following ones are dropped
+    END_OF_INPUT,
+    PAUSE,         // the reader stopped after a 'protocol' command
+    ERROR          // a stage threw; the following ones are dropped
+  };
+  struct Slot {
+    Command command;
+    Arena   scratch;
+    size_t  num_prompts = 0;  // prompts not written yet before the command
+    Result  result = Result::ACCEPTED;
+    Mark    mark = Mark::COMMAND;
+    SessionRecorder::clock_type::time_point received;
+  };
+
+  std::unique_ptr<Slot[]> slots(new Slot[NUM_STAGE_SLOTS]);
+  SpscRing<size_t> free_slots(NUM_STAGE_SLOTS), parsed(NUM_STAGE_SLOTS), executed(NUM_STAGE_SLOTS);
+  for(size_t i = 0; i < NUM_STAGE_SLOTS; ++i) {
+    slots[i].command.response_stream().exchange( _response_pool.acquire() );
+    slots[i].command.set_scratch( &slots[i].scratch );
+    free_slots.try_push( size_t(i) );
+  }
+
+  // Exceptions of the stages are rethrown after the threads are joined
+  std::exception_ptr read_error, execute_error, write_error;
+  bool paused;
+  do {
+    std::atomic<bool> stopping(false), write_failed(false);
+    paused = false;
+
+    std::thread reader_thread([&]{
+      const auto take_slot = [&](size_t& index){
+        wait_stage([&]{ return stopping.load() || free_slots.try_pop(index); });
+        return !stopping.load();
+      };
+      size_t num_prompts = 0;
+      size_t index;
+      try {
+        LineReader::line_type line;
+        for(;;) {
+          bool available;
+          {
+            // Waiting with a timeout lets the reader see the executor stopped on quit
+            TraceSpan span(_tracer, "read");
+            while( !(available = reader.next_buffered(line)) && !reader.eof() ) {
+              if(stopping.load()) return;
+              if(reader.wait(STAGE_READ_TIMEOUT)) reader.fill();
+            }
+          }
+          ++num_prompts;
+          if( available && !is_command_line(line) ) continue;
+          if( !take_slot(index) ) return;
+
+          auto& slot = slots[index];
+          slot.num_prompts = num_prompts;
+          slot.received = received_time();
+          num_prompts = 0;
+          if( !available ) {
+            slot.mark = Mark::END_OF_INPUT;
+            parsed.try_push( std::move(index) );
+            return;
+          }
+          {
+            TraceSpan span(_tracer, "parse");
+            slot.command.parse(trim_line(line));
+          }
+          slot.mark = Mark::COMMAND;
+          // The following input may be in another framing
+          const bool pause = InsensitiveEqual()(slot.command.name_view(), "protocol");
+          parsed.try_push( std::move(index) );
+          if( pause ) {
+            if( !take_slot(index) ) return;
+            slots[index].num_prompts = 0;
+            slots[index].mark = Mark::PAUSE;
+            parsed.try_push( std::move(index) );
+            return;
+          }
+        }
+      } catch( ... ) {
+        read_error = std::current_exception();
+        if( !take_slot(index) ) return;
+        slots[index].mark = Mark::ERROR;
+        parsed.try_push( std::move(index) );
+      }
+    });
+
+    std::thread writer_thread([&]{
+      // After an exception, the slots are returned without writing until the executor stops
+      const auto write = [&](auto&& output){
+        if( write_error ) return;
+        try {
+          output();
+        } catch( ... ) {
+          write_error = std::current_exception();
+          write_failed = true;
+        }
+      };
+      size_t index;
+      for(;;) {
+        // Responses are flushed when no more of them are ready
+        if( executed.empty() ) write([&]{ os.flush(); });
+        wait_stage([&]{ return executed.try_pop(index); });
+        auto& slot = slots[index];
+        const auto mark = slot.mark;
+        write([&]{
+          if( mark != Mark::PAUSE && mark != Mark::ERROR ) {
+            write_prompts(os, slot.num_prompts);
+            os << EOT;
+          }
+          if( mark == Mark::COMMAND || mark == Mark::QUIT ) {
+            respond(slot.command, slot.result, os, slot.received);
+          }
+        });
+        free_slots.try_push( std::move(index) );
+        if( mark != Mark::COMMAND ) break;
+      }
+      write([&]{ os.flush(); });
+    });
+
+    size_t index;
+    for(;;) {
+      wait_stage([&]{ return parsed.try_pop(index); });
+      auto& slot = slots[index];
+      if( slot.mark == Mark::COMMAND ) {
+        try {
+          slot.result = execute_command(slot.command);
+          if( slot.result == Result::ABORTED || _quit_flag || write_failed.load() ) slot.mark = Mark::QUIT;
+        } catch( ... ) {
+          execute_error = std::current_exception();
+          slot.mark = Mark::ERROR;
+        }
+      }
+      const auto mark = slot.mark;
+      paused = mark == Mark::PAUSE;
+      executed.try_push( std::move(index) );
+      if( mark != Mark::COMMAND ) break;
+    }
+    stopping = true;
+    reader_thread.join();
+    writer_thread.join();
+  } while( paused && !write_error && !_quit_flag && _requested_protocol == _protocol );
+
+  for(size_t i = 0; i < NUM_STAGE_SLOTS; ++i) {
+    _response_pool.release( slots[i].command.response_stream().exchange({}) );
+  }
+  for(const auto& error : { execute_error, write_error, read_error }) {
+    if( error ) std::rethrow_exception(error);
+  }
+}
+
+
+void Engine::binary_loop(LineReader& reader, std::ostream& os)
+{
+  // Responses are flushed only when no complete request is buffered, i.e. once per batch
+  Command command;
+  command.response_stream().exchange( _response_pool.acquire() );
+  command.set_scratch( &_arena );
+  std::vector<boost::string_ref> tokens;
+  LineReader::line_type payload;
+  while( !_quit_flag && _requested_protocol == _protocol ) {
+    if( !frame_buffered(reader) ) os.flush();
+    if( oversized_frame(reader) ) {
+      frame::write_response(os, ResponseStatus::ABORTED, OVERSIZED_REQUEST);
+      break;
+    }
+    {
+      TraceSpan span(_tracer, "read");
+      if( !read_frame(reader, payload) ) break;
+    }
+    bool assigned;
+    {
+      TraceSpan span(_tracer, "parse");
+      assigned = assign_request(command, payload, tokens);
+    }
+    if( assigned ) {
+      handle_command(command, os);
+    } else {
+      frame::write_response(os, ResponseStatus::FAILED, MALFORMED_REQUEST);
+    }
+  }
+  _response_pool.release( command.response_stream().exchange({}) );
+}
+
+
+void Engine::serve_input(Session& session, Command& command)
+{
+  // Sessions are served one at a time, so the quit flag and the protocol are borrowed
+  // by the current one
+  auto& reader = session.reader();
+  auto& os = session.output();
+  _protocol = _requested_protocol = session.protocol();
+  std::vector<boost::string_ref> tokens;
+  LineReader::line_type input;
+  while( !session.closing() ) {
+    if(_protocol == Protocol::BINARY) {
+      if( oversized_frame(reader, MAX_SESSION_INPUT_SIZE) ) {
+        frame::write_response(os, ResponseStatus::ABORTED, OVERSIZED_REQUEST);
+        session.close();
+        break;
+      }
+      if( !take_frame(reader, input) ) break;
+      if( assign_request(command, input, tokens) ) {
+        handle_command(command, os);
+      } else {
+        frame::write_response(os, ResponseStatus::FAILED, MALFORMED_REQUEST);
+      }
+    } else {
+      if( !reader.next_buffered(input) ) {
+        // The rest of the line is not read into the session without limit
+        if( reader.peek().size() > MAX_SESSION_INPUT_SIZE ) {
+          os << EOT << "? " << OVERSIZED_LINE << '\n' << EOT << '\n';
+          session.close();
+        }
+        break;
+      }
+      if( !is_command_line(input) ) {
+        os << "> ";
+        continue;
+      }
+      os << EOT;
+      command.parse(trim_line(input));
+      handle_command(command, os);
+    }
+
+    if(_quit_flag) {
+      _quit_flag = false;
+      session.close();
+      break;
+    }
+    _protocol = _requested_protocol;
+    if(_protocol == Protocol::TEXT) os << "> ";
+  }
+  if( !session.closing() && reader.eof() && _protocol == Protocol::TEXT ) {
+    os << EOT;
+  }
+  session.set_protocol(_protocol);
+}
+
+
+void Engine::add_default_options()
+{
+  _options.add_options()
+    ("disable-logging", "Disable logging")
+    ("log-file", bpo::value<std::string>()->default_value(Logger::DEFAULT_LOG_FILENAME), "Set log file")
+    ("log-dir", bpo::value<std::string>()->default_value(Logger::DEFAULT_LOG_DIR), "Set log dir")
+    ("log-level", bpo::value<std::string>()->default_value("debug"), "Minimum level of log records: debug, info, warning, error or fatal")
+    ("log-time-resolution", bpo::value<std::string>()->default_value("us"), "Resolution of log timestamps: s, ms, us or ns")
+    ("log-queue", bpo::value<size_t>()->default_value(0), "Write logs on a background thread with a queue of the size (power of 2)")
+    ("log-overflow", bpo::value<std::string>()->default_value("block"), "Policy when the log queue is full: block, drop or count")
+    ("pipelined", "Flush responses once per batch of buffered commands")
+    ("workers", bpo::value<size_t>()->default_value(0), "Run concurrent commands of a pipelined batch on worker threads")
+    ("threaded", "Read and write on their own threads, executing commands in between")
+    ("socket", bpo::value<std::string>(), "Serve sessions on a Unix domain socket")
+    ("record", bpo::value<std::string>(), "Record commands and their response status to a session file")
+    ("replay", bpo::value<std::string>(), "Replay a recorded session file and report throughput and latency")
+    ("replay-pacing", bpo::value<std::string>()->default_value("fast"), "Pacing of the replay: fast or original")
+    ("script", bpo::value<std::string>(), "Run commands in the file without prompts")
+    ("quiet", "Discard responses of the script")
+    ("stats", "Record latency of each command, shown by the 'stats' command")
+    ("cache-size", bpo::value<size_t>()->default_value(1024), "Maximum number of cached responses of cacheable commands; 0 disables the cache")
+    ("trace-file", bpo::value<std::string>(), "Write spans of command handling to the file in the Chrome trace event format")
+    ("trace-limit", bpo::value<size_t>()->default_value(1u << 20), "Maximum number of trace events buffered per thread")
+    ("help", "Show help")
+  ;
 }
 
 
-// Private functions
-//--------------------------------------------------------
 bool Engine::open_log()
 {
   // Initialize logger
@@ -147,6 +940,56 @@ bool Engine::open_log()
     return true;
   }
 
+  const auto& level = parsed_options()["log-level"].as<std::string>();
+  if(level == "debug") {
+    _logger.set_threshold(LogLevel::DEBUG);
+  } else if(level == "info") {
+    _logger.set_threshold(LogLevel::INFO);
+  } else if(level == "warning") {
+    _logger.set_threshold(LogLevel::WARNING);
+  } else if(level == "error") {
+    _logger.set_threshold(LogLevel::ERROR);
+  } else if(level == "fatal") {
+    _logger.set_threshold(LogLevel::FATAL);
+  } else {
+    std::cerr << "unknown log level: " << level << std::endl;
+    return false;
+  }
+
+  const auto& resolution = parsed_options()["log-time-resolution"].as<std::string>();
+  if(resolution == "s") {
+    _logger.set_timestamp_resolution(TimestampResolution::SECOND);
+  } else if(resolution == "ms") {
+    _logger.set_timestamp_resolution(TimestampResolution::MILLISECOND);
+  } else if(resolution == "us") {
+    _logger.set_timestamp_resolution(TimestampResolution::MICROSECOND);
+  } else if(resolution == "ns") {
+    _logger.set_timestamp_resolution(TimestampResolution::NANOSECOND);
+  } else {
+    std::cerr << "unknown log time resolution: " << resolution << std::endl;
+    return false;
+  }
+
+  if(auto queue_size = parsed_options()["log-queue"].as<size_t>()) {
+    const auto& policy = parsed_options()["log-overflow"].as<std::string>();
+    LogOverflow overflow;
+    if(policy == "block") {
+      overflow = LogOverflow::BLOCK;
+    } else if(policy == "drop") {
+      overflow = LogOverflow::DROP;
+    } else if(policy == "count") {
+      overflow = LogOverflow::COUNT;
+    } else {
+      std::cerr << "unknown log overflow policy: " << policy << std::endl;
+      return false;
+    }
+    if(queue_size < 2 || (queue_size & (queue_size - 1)) != 0) {
+      std::cerr << "log queue size must be a power of 2: " << queue_size << std::endl;
+      return false;
+    }
+    _logger.set_async(queue_size, overflow);
+  }
+
   return _logger.open(parsed_options()["log-file"].as<std::string>(),
                       parsed_options()["log-dir"].as<std::string>());
 
@@ -159,65 +1002,263 @@ void Engine::close_log()
 }
 
 
+bool Engine::open_record()
+{
+  if(!parsed_options().count("record")) return true;
+  try {
+    _recorder.reset(new SessionRecorder(parsed_options()["record"].as<std::string>()));
+  } catch( const std::exception& e ) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+void Engine::open_trace()
+{
+  if(!parsed_options().count("trace-file")) return;
+  _tracer.open(parsed_options()["trace-file"].as<std::string>(),
+               parsed_options()["trace-limit"].as<size_t>());
+}
+
+
+void Engine::close_trace()
+{
+  if(_tracer.enabled() && !_tracer.close()) {
+    std::cerr << "failed to write " << parsed_options()["trace-file"].as<std::string>() << std::endl;
+  }
+}
+
+
+auto Engine::response_status(Result result) noexcept -> ResponseStatus
+{
+  switch(result) {
+    case Result::ACCEPTED:
+      return ResponseStatus::ACCEPTED;
+    case Result::FAILED:
+      return ResponseStatus::FAILED;
+    default:
+      return ResponseStatus::ABORTED;
+  }
+}
+
+
 void Engine::handle_command(Command& command, std::ostream& os)
 {
-  bool status = true;
-  std::string response;
-
-  auto handler = _callback_list.find(command.name());
-  if(handler != _callback_list.end()) {
-    try {
-      auto& func = handler->second;
-      (*func)( command );
-      response = command.response();
-    } catch( const Failure& f ) {
-      status = false;
-      response = f.what();
-    } catch( const std::exception& e ) {
-      status = false;
-      response = e.what();
-      _quit_flag = true;
-    }
-  } else {
-    status = false;
-    response = (boost::format("unknown command: %s") % command.name()).str();
+  const auto received = received_time();
+  respond( command, execute_command(command), os, received );
+}
+
+
+void Engine::enable_stats()
+{
+  for(auto& entry : _callback_list) {
+    if(!entry.second.stats) entry.second.stats.reset(new CallbackStats);
   }
+  _stats_enabled = true;
+}
 
-  if(status) {
-    logger().info() << "Accept command: " << command.raw_string();
-  } else {
-    logger().error() << response;
+
+auto Engine::execute_command(Command& command) const -> Result
+{
+  const CallbackEntry* handler;
+  {
+    TraceSpan span(_tracer, "lookup");
+    handler = find_callback(command.name_view());
   }
+  return execute_callback(handler, command);
+}
+
+
+auto Engine::execute_callback(const CallbackEntry* handler, Command& command) const -> Result
+{
+  using clock_type = std::chrono::steady_clock;
 
-  if( response.size() == 0 || response[response.size()-1] != '\n' ) {
-    response += '\n';
+  if(!handler) {
+    command.response_stream() << "unknown command: " << command.name_view();
+    return Result::FAILED;
   }
+  TraceSpan span(_tracer, "callback", command.name_view());
+  // Disabled statistics cost this branch only
+  if(!handler->stats) return run_callback(*handler, command);
+
+  const auto begin = clock_type::now();
+  const auto result = run_callback(*handler, command);
+  const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - begin).count();
+  handler->stats->latency.record(static_cast<uint64_t>(elapsed));
+  if(result != Result::ACCEPTED) handler->stats->errors.fetch_add(1, std::memory_order_relaxed);
+  return result;
+}
 
-  os << ( status ? '=' : '?' )
-     << ' ' << response
-     << EOT << '\n';
+
+auto Engine::run_callback(const CallbackEntry& handler, Command& command) const -> Result
+{
+  if( !has_attribute(handler.attributes, CallbackAttribute::CACHEABLE) || _response_cache.capacity() == 0 ) {
+    return invoke_callback(handler, command);
+  }
+
+  // Keys are built in storage reused by each thread
+  thread_local std::string key;
+  ResponseCache::make_key(command, key);
+  if( _response_cache.find(key, command.response_stream()) ) return Result::ACCEPTED;
+  const auto result = invoke_callback(handler, command);
+  if( result == Result::ACCEPTED ) _response_cache.insert(key, command.response());
+  return result;
+}
+
+
+template<class F>
+auto Engine::call_guarded(Command& command, F&& function) -> Result
+{
+  try {
+    function();
+    if( command.failed() ) return Result::FAILED;
+  } catch( const Failure& f ) {
+    command.clear();
+    command.response_stream() << f.what();
+    return Result::FAILED;
+  } catch( const std::exception& e ) {
+    command.clear();
+    command.response_stream() << e.what();
+    return Result::ABORTED;
+  }
+  return Result::ACCEPTED;
+}
+
+
+auto Engine::invoke_callback(const CallbackEntry& handler, Command& command) -> Result
+{
+  if( handler.schema && !handler.schema->validate(command) ) {
+    return Result::FAILED;
+  }
+  if( !handler.job ) {
+    return call_guarded(command, [&]{ handler.function( command ); });
+  }
+
+  // Jobs run to completion in place out of the text loop
+  return call_guarded(command, [&]{
+    auto step = handler.job( command );
+    if( !step ) return;
+    ResponseBuffer progress;
+    JobContext context(command, progress);
+    while( !step(context) && !command.failed() ) progress.clear();
+  });
+}
+
+
+void Engine::start_job(const CallbackEntry& handler, Command& command, std::ostream& os,
+                       SessionRecorder::clock_type::time_point received)
+{
+  // The job keeps its own command while the loop reuses the given one
+  _jobs.emplace_back();
+  auto& job = _jobs.back();
+  job.received = received;
+  job.command.parse(command.raw_string());
+  job.command.set_scratch(&job.scratch);
+
+  auto result = Result::FAILED;
+  if( !handler.schema || handler.schema->validate(job.command) ) {
+    TraceSpan span(_tracer, "callback", job.command.name_view());
+    result = call_guarded(job.command, [&]{ job.step = handler.job( job.command ); });
+  }
+  if( result == Result::ACCEPTED && job.step ) return;
+
+  // Finished at once
+  respond(job.command, result, os, job.received);
+  _jobs.pop_back();
+}
+
+
+void Engine::resume_jobs(std::ostream& os)
+{
+  ResponseBuffer progress;
+  for(auto ite = _jobs.begin(); ite != _jobs.end(); ) {
+    // Output of a job follows the output held by the previous one
+    auto& job = *ite;
+    auto& out = ite == _jobs.begin() ? os : static_cast<std::ostream&>(std::prev(ite)->backlog);
+    auto result = Result::FAILED;
+    bool finished = true;
+    if( job.cancelled ) {
+      job.command.fail() << "cancelled";
+    } else {
+      TraceSpan span(_tracer, "job", job.command.name_view());
+      JobContext context(job.command, progress);
+      result = call_guarded(job.command, [&]{ finished = job.step(context); });
+      finished = finished || result != Result::ACCEPTED;
+      write_progress(out, progress);
+    }
+    if( !finished ) {
+      ++ite;
+      continue;
+    }
+
+    respond(job.command, result, out, job.received);
+    const auto held = job.backlog.str();
+    out.write(held.data(), held.size());
+    ite = _jobs.erase(ite);
+  }
   os.flush();
 }
 
 
+void Engine::respond(Command& command, Result result, std::ostream& os,
+                     SessionRecorder::clock_type::time_point received)
+{
+  const bool status = result == Result::ACCEPTED;
+  if(result == Result::ABORTED) {
+    _quit_flag = true;
+  }
+
+  const auto& response = command.response();
+  if(_recorder) {
+    _recorder->record(command.raw_string(), response_status(result), response, received);
+  }
+  {
+    TraceSpan span(_tracer, "log");
+    if(status) {
+      CLI_LOG(logger(), INFO) << "Accept command: " << command.raw_string();
+    } else {
+      CLI_LOG(logger(), ERROR) << response;
+    }
+  }
+
+  {
+    // Write the frame directly from the response buffer
+    TraceSpan span(_tracer, "write");
+    if(_protocol == Protocol::BINARY) {
+      frame::write_response(os, response_status(result), response);
+    } else {
+      os.put( status ? '=' : '?' ).put(' ');
+      os.write( response.data(), response.size() );
+      if( response.empty() || response.back() != '\n' ) {
+        os.put('\n');
+      }
+      os.put(EOT).put('\n');
+    }
+  }
+  if( command.has_scratch() ) command.scratch().reset();
+}
+
+
 // Default commands
 //--------------------------------------------------------
 void Engine::echo_command(Command& command)
 {
-  check_num_arguments_at_least(command, 1);
-  command.response_stream() << command.argument(0);
+  if( !check_num_arguments_at_least(command, 1, std::nothrow) ) return;
+  command.response_stream() << command.argument_view(0);
   for(auto i = 1; i < command.num_arguments(); ++i) {
-    command.response_stream() << ' ' << command.argument(i);
+    command.response_stream() << ' ' << command.argument_view(i);
   }
 }
 
 
 void Engine::list_commands_command(Command& command)
 {
-  check_num_arguments_equal(command, 0);
+  if( !check_num_arguments_equal(command, 0, std::nothrow) ) return;
   command.response_stream() << '\n';
-  for(auto ite = _callback_list.cbegin(); ite != _callback_list.cend(); ++ite) {
-    command.response_stream() << ite->first << '\n';
+  for(const auto& entry : _callback_list) {
+    command.response_stream() << entry.first << '\n';
   }
 }
 
@@ -225,22 +1266,111 @@ void Engine::list_commands_command(Command& command)
 void Engine::help_command(Command& command)
 {
   size_t size = 0;
-  for(auto ite = _callback_list.cbegin(); ite != _callback_list.cend(); ++ite) {
-    size = std::max( size, ite->first.size() );
+  for(const auto& entry : _callback_list) {
+    size = std::max( size, entry.first.size() );
   }
   size += 2;
-  for(auto ite = _callback_list.cbegin(); ite != _callback_list.cend(); ++ite) {
-    const auto& name = ite->first;
-    const auto& help = _help_list.find(name)->second;
+  for(const auto& entry : _callback_list) {
+    const auto& name = entry.first;
     command.response_stream() << '\n' << name;
     for(auto i = name.size(); i < size; ++i) command.response_stream() << ' ';
-    command.response_stream() << " : " << help;
+    command.response_stream() << " : " << entry.second.help;
+  }
+}
+
+
+void Engine::protocol_command(Command& command)
+{
+  // The response is written in the current protocol, and the next command is read in the new one
+  const auto name = command.argument_view(0);
+  if(name == "text") {
+    _requested_protocol = Protocol::TEXT;
+  } else if(name == "binary") {
+    _requested_protocol = Protocol::BINARY;
+  } else {
+    command.fail() << "unknown protocol: " << name;
+    return;
+  }
+  command.response_stream() << name;
+}
+
+
+void Engine::stats_command(Command& command)
+{
+  if(!_stats_enabled) {
+    command.fail() << "statistics are disabled; run with '--stats'";
+    return;
+  }
+
+  std::vector<std::pair<const std::string*, CallbackStats*>> stats;
+  for(const auto& entry : _callback_list) {
+    stats.emplace_back(&entry.first, entry.second.stats.get());
+  }
+
+  if(command.num_arguments() > 0) {
+    if(command.argument_view(0) != "reset") {
+      command.fail() << "unknown argument of stats: " << command.argument_view(0);
+      return;
+    }
+    for(auto& entry : stats) {
+      entry.second->errors.store(0, std::memory_order_relaxed);
+      entry.second->latency.reset();
+    }
+    return;
+  }
+
+  // Commands called at least once, in the order of their names
+  std::sort(stats.begin(), stats.end(), [](const std::pair<const std::string*, CallbackStats*>& lhs,
+                                           const std::pair<const std::string*, CallbackStats*>& rhs){
+    return *lhs.first < *rhs.first;
+  });
+  // Names are left aligned, and numbers are right aligned as the help
+  constexpr size_t NUMBER_WIDTH = 10;
+  size_t size = 0;
+  for(const auto& entry : stats) size = std::max(size, entry.first->size());
+  auto& os = command.response_stream();
+  const auto column = [&](const std::string& text, size_t width){
+    for(auto i = text.size(); i < width; ++i) os << ' ';
+    os << text;
+  };
+  os << "\ncommand";
+  for(auto i = sizeof("command") - 1; i < size; ++i) os << ' ';
+  for(auto header : { "calls", "errors", "p50[ns]", "p90[ns]", "p99[ns]", "p99.9[ns]", "max[ns]" }) {
+    column(header, NUMBER_WIDTH);
+  }
+  for(const auto& entry : stats) {
+    const auto& latency = entry.second->latency;
+    const auto calls = latency.count();
+    if(calls == 0) continue;
+    os << '\n' << *entry.first;
+    for(auto i = entry.first->size(); i < size; ++i) os << ' ';
+    for(auto value : { calls, entry.second->errors.load(std::memory_order_relaxed),
+                       latency.percentile(0.5), latency.percentile(0.9), latency.percentile(0.99),
+                       latency.percentile(0.999), latency.max() }) {
+      column(std::to_string(value), NUMBER_WIDTH);
+    }
+  }
+  if(_response_cache.capacity() > 0) {
+    os << "\nresponse cache: " << _response_cache.hits() << " hits, " << _response_cache.misses() << " misses";
+  }
+}
+
+
+void Engine::cancel_command(Command& command)
+{
+  size_t num_cancelled = 0;
+  for(auto& job : _jobs) {
+    if( job.cancelled ) continue;
+    if( command.num_arguments() > 0 && !InsensitiveEqual()(job.command.name_view(), command.argument_view(0)) ) continue;
+    job.cancelled = true;
+    ++num_cancelled;
   }
+  command.response_stream() << num_cancelled << (num_cancelled == 1 ? " job" : " jobs") << " cancelled";
 }
 
 
 void Engine::quit_command(Command& command)
 {
-  check_num_arguments_equal(command, 0);
+  if( !check_num_arguments_equal(command, 0, std::nothrow) ) return;
   _quit_flag = true;
 }
@@ -1,20 +1,66 @@
 #ifndef CLI_BASIC_ENGINE_ENGINE_HPP
 #define CLI_BASIC_ENGINE_ENGINE_HPP
 
+#include <atomic>
+#include <list>
 #include <memory>
 #include <iostream>
+#include <sstream>
 #include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
+#include "arena.hpp"
+#include "argument_schema.hpp"
+#include "callback.hpp"
 #include "hash_map.hpp"
+#include "job.hpp"
+#include "latency_histogram.hpp"
 #include "logger.hpp"
+#include "protocol.hpp"
+#include "response_cache.hpp"
+#include "session_record.hpp"
+#include "trace.hpp"
+#include "response_buffer.hpp"
 
 
 namespace cli {
 
   class Command;
-  class CallbackFunction;
+  class LineReader;
+  class Server;
+  class Session;
+
+  /*!
+   * @brief  Attributes of registered callbacks (bit flags)
+   */
+  enum struct CallbackAttribute : unsigned {
+    NONE       = 0,
+    /*!
+     * The callback is reentrant, and it does not modify the engine.
+     * With the '--pipelined' and '--workers' options, consecutive concurrent commands
+     * run on the worker threads, and the other commands act as barriers.
+     */
+    CONCURRENT = 1u << 0,
+    /*!
+     * The response depends on the name and the arguments only, until invalidated.
+     * Accepted responses are cached with the '--cache-size' option, and the engine
+     * has to call invalidate_cache() when the state the responses depend on changes.
+     */
+    CACHEABLE  = 1u << 1
+  };
+
+  inline CallbackAttribute operator|(CallbackAttribute lhs, CallbackAttribute rhs) noexcept
+  {
+    return static_cast<CallbackAttribute>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+  }
+
+  //! Check the attribute set contains the attribute
+  inline bool has_attribute(CallbackAttribute attributes, CallbackAttribute attribute) noexcept
+  {
+    return (static_cast<unsigned>(attributes) & static_cast<unsigned>(attribute)) != 0;
+  }
 
   /*!
    * @brief  Basic application engine of the common text interface
@@ -27,20 +73,50 @@ namespace cli {
    *   After starting with '=' or '?', there can be multi-line response until EOT is found.
    *
    * Any other strings, not starts with '>', not between '=' or '?' and EOT, are ignored.
+   *
+   * ~ Starting with '~', it is a progress line of a long-running command before its response.
    * @endcode
+   * After 'protocol binary' is accepted, commands and responses are exchanged in the
+   * length-prefixed frames of cli::frame until 'protocol text' is accepted.
    */
   class Engine : private boost::noncopyable {
 
+    //! Statistics of calls recorded with the '--stats' option
+    struct CallbackStats {
+      std::atomic<uint64_t> errors{ 0 };
+      LatencyHistogram      latency;  // of validation and the callback, in ns
+    };
+
+    //! Registered callback function with its help comment, attributes and argument schema
+    struct CallbackEntry {
+      Callback                        function;
+      std::string                     help;
+      CallbackAttribute               attributes;
+      boost::optional<ArgumentSchema> schema;
+      std::unique_ptr<CallbackStats>  stats;  // null unless the statistics are enabled
+      JobFactory                      job;    // set for long-running commands
+    };
+
+    //! Job running in the text loop
+    struct RunningJob {
+      Command            command;
+      Job                step;
+      Arena              scratch;
+      std::ostringstream backlog;  // output of the following commands, held until the job finishes
+      bool               cancelled = false;
+      SessionRecorder::clock_type::time_point received;  // read time of the command, for the record
+    };
+
     /*!
      * @typedef  callback_list
      * @brief    Type of container for callback functions
      */
-    using callback_list = HashMap<std::unique_ptr<CallbackFunction>>;
-    /*!
-     * @typedef  help_list
-     * @brief    Type of container for help comments
-     */
-    using help_list     = HashMap<std::string>;
+    using callback_list = HashMap<CallbackEntry>;
+
+    //! Result of command execution
+    enum struct Result {
+      ACCEPTED, FAILED, ABORTED
+    };
 
 
     public:
@@ -75,9 +151,73 @@ namespace cli {
      * @brief      Run main loop for the interactive command line application
      * @param[in]  is : input stream  [default = std::cin]
      * @param[in]  os : output stream [default = std::cout]
+     * @note       With the '--pipelined' option, responses are flushed only when
+     *             no more input is buffered, i.e. once per batch of commands.
+     *             Adding '--workers N', concurrent commands in a batch run on N threads,
+     *             and their responses are written in the input order.
+     *             The loop terminates on 'quit' or at the end of the input.
+     *             The '--threaded' option requires a file descriptor, so this loop
+     *             runs without it; see main_loop(int, std::ostream&).
+     * @attention  Input is read ahead from is.rdbuf() as far as it is available, so
+     *             after 'quit' or a failure the stream may have lost lines following
+     *             the last command. Give the loop a stream of its own.
      */
     int main_loop(std::istream& is = std::cin, std::ostream& os = std::cout);
 
+    /*!
+     * @brief      Run main loop reading commands directly from a file descriptor
+     * @param[in]  fd : readable file descriptor, e.g. STDIN_FILENO
+     * @param[in]  os : output stream [default = std::cout]
+     * @note       With the '--threaded' option, commands are read, executed and responded
+     *             on their own threads. An exception on any of them stops the loop, and
+     *             it is reported as main_loop() reports others.
+     */
+    int main_loop(int fd, std::ostream& os = std::cout);
+
+    /*!
+     * @brief      Serve sessions on a Unix domain socket until stop() is called
+     * @param[in]  socket_path : path of the socket
+     * @note       Each session speaks the same protocol as main_loop(), and has its own
+     *             input buffer and quit flag; 'quit' closes the session only.
+     *             A session whose line or request frame exceeds 1 MiB is closed with
+     *             a failure response.
+     *             Registered commands are shared by all sessions.
+     */
+    int serve(const std::string& socket_path);
+
+    /*!
+     * @brief      Replay a session file recorded with the '--record' option
+     * @param[in]  path : path of the session file
+     * @param[in]  os   : output stream of the report [default = std::cout]
+     * @retval     EXIT_FAILURE : the file cannot be read, or some responses do not match
+     * @note       Commands are run as fast as possible, or with '--replay-pacing original'
+     *             at their recorded times. Responses are discarded after their status, size
+     *             and hash are verified, and the throughput and latency are reported.
+     *             'quit' does not stop the replay, since a file may contain many sessions.
+     */
+    int replay(const std::string& path, std::ostream& os = std::cout);
+
+    /*!
+     * @brief      Run the commands in a script file
+     * @param[in]  path : path of the script
+     * @param[in]  os   : output stream [default = std::cout]
+     * @retval     EXIT_FAILURE : the file cannot be read, or some commands fail
+     * @note       The file is mapped into memory and scanned in place. Comments and blank
+     *             lines are skipped as main_loop() does, and no prompt nor EOT is echoed;
+     *             only the responses are written without flushing them one by one, or they
+     *             are discarded with the '--quiet' option. The script ends at 'quit'.
+     */
+    int run_script(const std::string& path, std::ostream& os = std::cout);
+
+    //! Stop serve(); it can be called from other threads and signal handlers
+    void stop() noexcept;
+
+    //! Accessor to container of parsed program options
+    auto parsed_options() const noexcept -> const boost::program_options::variables_map&
+    {
+      return _parsed_options;
+    }
+
 
     protected:
     // Accessors
@@ -91,13 +231,79 @@ namespace cli {
     /*!
      * @brief      Alias function to register callback member function to the engine
      * @param[in]  command : command name
-     * @param[in]  cbf     : pointer to the callback member function
+     * @param[in]  cbf     : callback; a member function made by make_callback(),
+     *                       a free function or a function object such as a lambda
      * @param[in]  help    : [optional] help comment for the command
+     * @param[in]  attributes : [optional] attributes of the callback
      * @attention  It overwrites the existent same name command.
      */
     void register_callback(std::string command,
-                           std::unique_ptr<CallbackFunction> cbf,
-                           std::string help = "No help") noexcept;
+                           Callback cbf,
+                           std::string help = "No help",
+                           CallbackAttribute attributes = CallbackAttribute::NONE) noexcept;
+
+    /*!
+     * @brief      Register callback function with the schema of its arguments
+     * @param[in]  command : command name
+     * @param[in]  cbf     : callback
+     * @param[in]  schema  : schema validated before the callback is called
+     * @param[in]  help    : [optional] help comment for the command
+     * @param[in]  attributes : [optional] attributes of the callback
+     * @note       Commands not satisfying the schema are responded with '?' without calling
+     *             the callback, and the callback reads the parsed numbers by
+     *             Command::integer_argument() and Command::real_argument().
+     * @code
+     * register_callback( "square", make_callback(this, &MyEngine::square),
+     *                    ArgumentSchema().integer("value", -1000, 1000),
+     *                    "Square of the value" );
+     * @endcode
+     */
+    void register_callback(std::string command,
+                           Callback cbf,
+                           ArgumentSchema schema,
+                           std::string help = "No help",
+                           CallbackAttribute attributes = CallbackAttribute::NONE) noexcept;
+
+    /*!
+     * @brief      Register a long-running command
+     * @param[in]  command : command name
+     * @param[in]  factory : function starting a job for each call of the command
+     * @param[in]  help    : [optional] help comment for the command
+     * @param[in]  attributes : [optional] attributes of the callback
+     * @note       In the text loop, the engine keeps reading and executing the following
+     *             commands while jobs run, resuming the jobs one step at a time between them.
+     *             Progress lines are written as they are made, and the responses keep the
+     *             order of the commands, so the ones after a job wait for its response.
+     *             The 'cancel' command finishes jobs with '?' at their next step.
+     *             The other loops run a job to completion in place, without progress lines.
+     * @code
+     * register_job( "count", [](Command& command) -> Job {
+     *   long long done = 0;
+     *   return [=](JobContext& context) mutable {
+     *     context.progress() << ++done;
+     *     return done == 10;
+     *   };
+     * }, "Count to ten" );
+     * @endcode
+     */
+    void register_job(std::string command,
+                      JobFactory factory,
+                      std::string help = "No help",
+                      CallbackAttribute attributes = CallbackAttribute::NONE) noexcept;
+
+    /*!
+     * @brief      Register a long-running command with the schema of its arguments
+     * @param[in]  command : command name
+     * @param[in]  factory : function starting a job for each call of the command
+     * @param[in]  schema  : schema validated before the job starts
+     * @param[in]  help    : [optional] help comment for the command
+     * @param[in]  attributes : [optional] attributes of the callback
+     */
+    void register_job(std::string command,
+                      JobFactory factory,
+                      ArgumentSchema schema,
+                      std::string help = "No help",
+                      CallbackAttribute attributes = CallbackAttribute::NONE) noexcept;
 
     /*!
      * @brief      Remove registered command
@@ -107,16 +313,36 @@ namespace cli {
      */
     bool remove_callback(const std::string& command);
 
-    //! Accessor to container of program options
-    auto options() noexcept -> boost::program_options::options_description&
+    //! Drop all the cached responses
+    void invalidate_cache()
     {
-      return _options;
+      _response_cache.invalidate();
     }
 
-    //! Accessor to container of parsed program options
-    auto parsed_options() const noexcept -> const boost::program_options::variables_map&
+    /*!
+     * @brief      Drop the cached responses of the command
+     * @param[in]  command : command name
+     */
+    void invalidate_cache(boost::string_ref command)
     {
-      return _parsed_options;
+      _response_cache.invalidate(command);
+    }
+
+    //! Accessor to the cache of responses of cacheable commands, e.g. for hit counters
+    auto response_cache() const noexcept -> const ResponseCache&
+    {
+      return _response_cache;
+    }
+
+    /*!
+     * @brief   Accessor to container of program options
+     * @note    Options of the engine are added on the first access, so constructing
+     *          an engine does not build the description.
+     */
+    auto options() -> boost::program_options::options_description&
+    {
+      if(_options.options().empty()) add_default_options();
+      return _options;
     }
 
     Logger& logger() noexcept
@@ -124,12 +350,70 @@ namespace cli {
       return _logger;
     }
 
+    /*!
+     * @brief  Accessor to the tracer enabled by the '--trace-file' option
+     * @code
+     * CLI_TRACE_SPAN(tracer(), "load");
+     * @endcode
+     */
+    Tracer& tracer() noexcept
+    {
+      return _tracer;
+    }
+
+    /*!
+     * @brief      Run the parsed command, and write its response
+     * @param[in]  command : parsed command; the response is stored in it
+     * @param[in]  os      : output stream
+     */
+    void handle_command(Command& command, std::ostream& os);
+
     private:
+    int main_loop(LineReader&, std::ostream&);
+    void text_loop(LineReader&, std::ostream&);
+    void pipelined_loop(LineReader&, std::ostream&);
+    void threaded_loop(LineReader&, std::ostream&);
+    void binary_loop(LineReader&, std::ostream&);
+    void serve_input(Session&, Command&);
+
+    //! Find the callback of the command; returns nullptr if not registered
+    const CallbackEntry* find_callback(boost::string_ref command) const noexcept;
+    //! Register the entry, replacing the existent one
+    void add_callback(std::string command, CallbackEntry entry);
+
+    void add_default_options();
     bool open_log();
     void close_log();
+    bool open_record();
+    void open_trace();
+    void close_trace();
+    static ResponseStatus response_status(Result) noexcept;
+
+    //! Allocate the statistics of all the commands
+    void enable_stats();
 
-    //! Handle commands
-    void handle_command(Command&, std::ostream&);
+    //! Run the callback of the command; it can be called concurrently
+    Result execute_command(Command&) const;
+    //! Run the callback looked up for the command, which is unknown if it is null
+    Result execute_callback(const CallbackEntry*, Command&) const;
+    //! Take the response from the cache, or call the callback
+    Result run_callback(const CallbackEntry&, Command&) const;
+    //! Validate the arguments and call the callback, or run the job to completion
+    static Result invoke_callback(const CallbackEntry&, Command&);
+    //! Call the function, converting exceptions and failures of the command into the result
+    template<class F>
+    static Result call_guarded(Command&, F&&);
+    //! Start the job of the command in the text loop, or respond if it finished at once
+    void start_job(const CallbackEntry&, Command&, std::ostream&, SessionRecorder::clock_type::time_point received);
+    //! Run a step of each job, and respond to the finished ones
+    void resume_jobs(std::ostream&);
+    //! Time a command is read, which is taken only while recording
+    SessionRecorder::clock_type::time_point received_time() const noexcept
+    {
+      return _recorder ? SessionRecorder::clock_type::now() : SessionRecorder::clock_type::time_point();
+    }
+    //! Log and write the response of the executed command, read at the given time
+    void respond(Command&, Result, std::ostream&, SessionRecorder::clock_type::time_point received);
 
 
     // Default commands
@@ -146,25 +430,49 @@ namespace cli {
      *  echo (message) | Echo test
      *  list_commands  | Show the list of registered commands
      *  help           | Show the help of each command
+     *  protocol (name)| Switch the framing to 'text' or 'binary'
+     *  stats [reset]  | Show latency percentiles of each command, or clear them
+     *  cancel [name]  | Cancel the running jobs, or the ones of the command
      *  quit           | Quit the application
      */
     void echo_command(Command&);
     void list_commands_command(Command&);
     void help_command(Command&);
+    void protocol_command(Command&);
+    void stats_command(Command&);
+    void cancel_command(Command&);
     void quit_command(Command&);
 
 
     //--------------------------------------------------------
     // container for callbacks
-    callback_list _callback_list;
-    help_list     _help_list;
+    callback_list  _callback_list;
+    // statistics are recorded with the '--stats' option
+    bool           _stats_enabled;
+    // storage of responses reused across commands
+    ResponsePool  _response_pool;
+    // scratch memory of the command being handled, reset after each response
+    Arena         _arena;
+    // responses of cacheable commands
+    mutable ResponseCache _response_cache;
+    // server running in serve()
+    std::atomic<Server*> _server;
+    // jobs in the order of their commands
+    std::list<RunningJob> _jobs;
     // flags
     bool _quit_flag;
+    // framing of responses, and the one switched to after the current command
+    Protocol _protocol;
+    Protocol _requested_protocol;
     // options
     boost::program_options::options_description _options;
     boost::program_options::variables_map       _parsed_options;
     // logger
     Logger _logger;
+    // recorder of commands with the '--record' option
+    std::unique_ptr<SessionRecorder> _recorder;
+    // spans written to the file of the '--trace-file' option; it is mutable to trace const functions
+    mutable Tracer _tracer;
 
   };
 
@@ -1,7 +1,5 @@
-#include <algorithm>
-#include <string>
-
-#include <cctype>
+#include <cstdint>
+#include <cstring>
 
 #include "hash_map.hpp"
 
@@ -9,25 +7,77 @@
 using namespace cli;
 
 namespace {
-  std::hash<std::string> to_hash;
+
+  constexpr uint64_t BYTES_01 = 0x0101010101010101ull;
+  constexpr uint64_t BYTES_80 = 0x8080808080808080ull;
+
+  template<class T>
+  inline uint64_t load(const char* data) noexcept
+  {
+    T word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+  }
+
+  /*!
+   * @brief  Load the last 1 to 7 bytes into a word
+   * @note   Overlapping loads avoid a call of memcpy with a variable size.
+   */
+  inline uint64_t load_tail(const char* data, size_t size) noexcept
+  {
+    if(size >= 4) return load<uint32_t>(data) | (load<uint32_t>(data + size - 4) << 32);
+    if(size >= 2) return load<uint16_t>(data) | (load<uint16_t>(data + size - 2) << 16);
+    return static_cast<unsigned char>(*data);
+  }
+
+  /*!
+   * @brief  Fold 'A'-'Z' in the 8 bytes to lower case (SWAR)
+   * @note   Bytes out of ASCII are kept as they are.
+   */
+  inline uint64_t fold_case(uint64_t word) noexcept
+  {
+    const auto heptets  = word & ~BYTES_80;
+    const auto above_z  = heptets + BYTES_01 * (0x7f - 'Z');
+    const auto from_a   = heptets + BYTES_01 * (0x80 - 'A');
+    const auto is_upper = (above_z ^ from_a) & ~word & BYTES_80;
+    return word | (is_upper >> 2);
+  }
+
+  inline uint64_t mix(uint64_t hash, uint64_t word) noexcept
+  {
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 32);
+  }
+
 }
 
 
-bool InsensitiveEqual::operator()(const std::string& lhs, const std::string& rhs) const noexcept
+bool InsensitiveEqual::operator()(boost::string_ref lhs, boost::string_ref rhs) const noexcept
 {
   if(lhs.size() != rhs.size()) return false;
-  for( auto i = 0; i < lhs.size(); ++i ) {
-    if(::tolower(lhs[i]) != ::tolower(rhs[i])) {
+  const auto size = lhs.size();
+  size_t i = 0;
+  for( ; i + 8 <= size; i += 8 ) {
+    if(fold_case(load<uint64_t>(lhs.data() + i)) != fold_case(load<uint64_t>(rhs.data() + i))) {
       return false;
     }
   }
-  return true;
+  return i == size ||
+         fold_case(load_tail(lhs.data() + i, size - i)) == fold_case(load_tail(rhs.data() + i, size - i));
 }
 
 
-auto InsensitiveHash::operator()(std::string str) const noexcept
+auto InsensitiveHash::operator()(boost::string_ref str) const noexcept
   -> InsensitiveHash::result_type
 {
-  std::transform( str.begin(), str.end(), str.begin(), ::tolower );
-  return to_hash( str );
+  const auto size = str.size();
+  uint64_t hash = size;
+  size_t i = 0;
+  for( ; i + 8 <= size; i += 8 ) {
+    hash = mix(hash, fold_case(load<uint64_t>(str.data() + i)));
+  }
+  if(i < size) {
+    hash = mix(hash, fold_case(load_tail(str.data() + i, size - i)));
+  }
+  return static_cast<result_type>(mix(hash, size));
 }
@@ -1,7 +1,9 @@
 #ifndef CLI_BASIC_ENGINE_HASH_MAP_HPP
 #define CLI_BASIC_ENGINE_HASH_MAP_HPP
 
-#include <unordered_map>
+#include <string>
+#include <boost/unordered_map.hpp>
+#include <boost/utility/string_ref.hpp>
 
 
 namespace cli {
@@ -26,7 +28,7 @@ namespace cli {
      * assert( comp(str1,str2) == true );
      * @endcode
      */
-    bool operator()(const std::string&, const std::string&) const noexcept;
+    bool operator()(boost::string_ref, boost::string_ref) const noexcept;
 
   };
 
@@ -44,6 +46,7 @@ namespace cli {
      * @brief   Generates hash value from the string
      * @return  integral hash value
      * @note    It enables insensitive comparison of string.
+     *          Only ASCII letters are folded, 8 characters at a time, without allocation.
      * @code
      * std::string str1 = "test";
      * std::string str2 = "TEST";
@@ -57,17 +60,49 @@ namespace cli {
      * assert(ist_hash(str1) == ist_hash(str2) );
      * @endcode
      */
-    result_type operator()(std::string) const noexcept;
+    result_type operator()(boost::string_ref) const noexcept;
 
   };
 
 
   /*!
-   * @typedef HashMap
    * @brief   Key-value map with insensitive string keys
+   * @note    Keys are looked up by string views without constructing std::string.
+   * @code
+   * HashMap<int> map;
+   * map.emplace("key", 1);
+   * assert( map.find(boost::string_ref("KEY")) != map.end() );
+   * @endcode
    */
   template<typename ValueType>
-  using HashMap = std::unordered_map<std::string, ValueType, InsensitiveHash, InsensitiveEqual>;
+  class HashMap : public boost::unordered_map<std::string, ValueType, InsensitiveHash, InsensitiveEqual> {
+
+    using base_type = boost::unordered_map<std::string, ValueType, InsensitiveHash, InsensitiveEqual>;
+
+    public:
+    using typename base_type::iterator;
+    using typename base_type::const_iterator;
+    using base_type::base_type;
+
+    //! Find the element by a key view
+    iterator find(boost::string_ref key)
+    {
+      return base_type::find(key, InsensitiveHash(), InsensitiveEqual());
+    }
+
+    //! Find the element by a key view
+    const_iterator find(boost::string_ref key) const
+    {
+      return base_type::find(key, InsensitiveHash(), InsensitiveEqual());
+    }
+
+    //! Returns 1 if the key is found, otherwise 0
+    size_t count(boost::string_ref key) const
+    {
+      return find(key) != this->end() ? 1 : 0;
+    }
+
+  };
 
 }
 
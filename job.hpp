@@ -0,0 +1,88 @@
+/*!
+ * @file  job.hpp
+ * @brief Long-running commands resumed step by step
+ */
+#ifndef CLI_BASIC_ENGINE_JOB_HPP
+#define CLI_BASIC_ENGINE_JOB_HPP
+
+#include <functional>
+#include <boost/noncopyable.hpp>
+
+#include "command.hpp"
+#include "response_buffer.hpp"
+
+
+namespace cli {
+
+  /*!
+   * @brief  Context passed to each step of a job
+   * @code
+   * // Usage in a step
+   * context.progress() << done << '/' << total;
+   * context.command().response_stream() << "final response";
+   * @endcode
+   */
+  class JobContext : private boost::noncopyable {
+
+    public:
+    /*!
+     * @brief      Ctor.
+     * @param[in]  command  : command which started the job
+     * @param[in]  progress : buffer of progress lines
+     */
+    JobContext(Command& command, ResponseBuffer& progress) noexcept
+      : _command(command), _progress(progress)
+    {
+    }
+
+    //! Returns the command which started the job; its response is the final response
+    Command& command() const noexcept
+    {
+      return _command;
+    }
+
+    //! Returns the stream of a new progress line
+    ResponseBuffer& progress()
+    {
+      if(!_progress.empty() && _progress.str().back() != '\n') _progress << '\n';
+      return _progress;
+    }
+
+    private:
+    Command&        _command;
+    ResponseBuffer& _progress;
+
+  };
+
+
+  /*!
+   * @typedef  Job
+   * @brief    Step of a long-running command, which returns true when the job finished
+   * @note     A step should return in a short time, keeping its state in the function
+   *           object. The job also finishes when the command is marked as failed,
+   *           and it reports failures by throwing Failure as callbacks do.
+   */
+  using Job = std::function<bool(JobContext&)>;
+
+  /*!
+   * @typedef  JobFactory
+   * @brief    Function starting a job for the command
+   * @note     Returning an empty job finishes the command at once, as a callback.
+   * @code
+   * JobFactory count = [](Command& command) -> Job {
+   *   auto total = command.integer_argument(0);
+   *   long long done = 0;
+   *   return [=](JobContext& context) mutable {
+   *     context.progress() << ++done << '/' << total;
+   *     if(done < total) return false;
+   *     context.command().response_stream() << "counted " << total;
+   *     return true;
+   *   };
+   * };
+   * @endcode
+   */
+  using JobFactory = std::function<Job(Command&)>;
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_JOB_HPP */
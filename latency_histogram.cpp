@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <cmath>
+
+#include "latency_histogram.hpp"
+
+
+using namespace cli;
+
+
+LatencyHistogram::LatencyHistogram() noexcept
+{
+  reset();
+}
+
+
+uint64_t LatencyHistogram::count() const noexcept
+{
+  uint64_t count = 0;
+  for(const auto& bucket : _counts) count += bucket.load(std::memory_order_relaxed);
+  return count;
+}
+
+
+uint64_t LatencyHistogram::percentile(double ratio) const noexcept
+{
+  const auto total = count();
+  if(total == 0) return 0;
+  // The rank of the value, counted from 1
+  const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(ratio * static_cast<double>(total))));
+  uint64_t count = 0;
+  for(size_t i = 0; i < NUM_BUCKETS; ++i) {
+    count += _counts[i].load(std::memory_order_relaxed);
+    if(count >= rank) return std::min(bucket_upper_bound(i), max());
+  }
+  return max();
+}
+
+
+void LatencyHistogram::reset() noexcept
+{
+  for(auto& bucket : _counts) bucket.store(0, std::memory_order_relaxed);
+  _max.store(0, std::memory_order_relaxed);
+}
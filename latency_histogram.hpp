@@ -0,0 +1,98 @@
+/*!
+ * @file  latency_histogram.hpp
+ * @brief Log-linear histogram of latencies with bounded relative error
+ */
+#ifndef CLI_BASIC_ENGINE_LATENCY_HISTOGRAM_HPP
+#define CLI_BASIC_ENGINE_LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace cli {
+
+  /*!
+   * @brief  Histogram of latencies in the HDR histogram layout
+   * @note   Each power of two range is split into SUB_BUCKETS linear buckets, so
+   *         percentiles are reported within 1/SUB_BUCKETS (about 3%) of the recorded
+   *         values. Counts are relaxed atomics, so values can be recorded from
+   *         concurrent threads without a lock.
+   * @code
+   * // Usage
+   * LatencyHistogram histogram;
+   * histogram.record( 1234 );
+   * auto p99 = histogram.percentile( 0.99 );
+   * @endcode
+   */
+  class LatencyHistogram : private boost::noncopyable {
+
+    public:
+    //! The number of bits of linear buckets in each power of two range
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+
+    //! Values are saturated to this bit width (about 68 s in ns)
+    static constexpr unsigned VALUE_BITS = 36;
+    static constexpr size_t NUM_BUCKETS = (VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    //! Ctor. with no value
+    LatencyHistogram() noexcept;
+
+    //! Record a value
+    void record(uint64_t value) noexcept
+    {
+      _counts[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+      auto max = _max.load(std::memory_order_relaxed);
+      while(value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+    }
+
+    //! Returns the number of recorded values
+    uint64_t count() const noexcept;
+
+    //! Returns the maximum recorded value
+    uint64_t max() const noexcept
+    {
+      return _max.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * @brief      Returns the value at the ratio, e.g. 0.99 for p99
+     * @note       It is the upper bound of the bucket, or the maximum if it is smaller.
+     *             It returns 0 if no value is recorded.
+     */
+    uint64_t percentile(double ratio) const noexcept;
+
+    //! Clear the recorded values
+    void reset() noexcept;
+
+    //! Returns the index of the bucket containing the value
+    static size_t bucket_index(uint64_t value) noexcept
+    {
+      constexpr uint64_t LIMIT = (uint64_t(1) << VALUE_BITS) - 1;
+      if(value > LIMIT) value = LIMIT;
+      if(value < SUB_BUCKETS) return static_cast<size_t>(value);
+      const unsigned shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+      return static_cast<size_t>((shift + 1) * SUB_BUCKETS + (value >> shift) - SUB_BUCKETS);
+    }
+
+    //! Returns the largest value in the bucket
+    static uint64_t bucket_upper_bound(size_t index) noexcept
+    {
+      if(index < SUB_BUCKETS) return index;
+      const auto shift = index / SUB_BUCKETS - 1;
+      return ((index % SUB_BUCKETS + SUB_BUCKETS + 1) << shift) - 1;
+    }
+
+    private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> _counts;
+    std::atomic<uint64_t>                          _max;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_LATENCY_HISTOGRAM_HPP */
@@ -0,0 +1,164 @@
+#include <algorithm>
+
+#include <cerrno>
+#include <cstring>
+#include <cctype>
+#include <system_error>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "line_reader.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  constexpr size_t WOULD_BLOCK = static_cast<size_t>(-1);
+
+}
+
+
+LineReader::LineReader(int fd, size_t buffer_size)
+  : _fd(fd), _source(nullptr), _buffer(buffer_size > 0 ? buffer_size : 1),
+    _begin(0), _scan(0), _end(0), _eof(false)
+{
+}
+
+
+LineReader::LineReader(std::streambuf* source, size_t buffer_size)
+  : _fd(-1), _source(source), _buffer(buffer_size > 0 ? buffer_size : 1),
+    _begin(0), _scan(0), _end(0), _eof(false)
+{
+}
+
+
+bool LineReader::next(line_type& line)
+{
+  while( !next_buffered(line) ) {
+    if( !fill() ) return next_buffered(line);
+  }
+  return true;
+}
+
+
+bool LineReader::next_buffered(line_type& line) noexcept
+{
+  // memchr is vectorized by the C library
+  auto head = _buffer.data();
+  auto found = static_cast<const char*>(std::memchr(head + _scan, '\n', _end - _scan));
+  if(found != nullptr) {
+    line = line_type(head + _begin, found - (head + _begin));
+    _begin = _scan = found - head + 1;
+    return true;
+  }
+  _scan = _end;
+  if(_eof && _begin != _end) {
+    line = line_type(head + _begin, _end - _begin);
+    _begin = _scan = _end;
+    return true;
+  }
+  return false;
+}
+
+
+bool LineReader::next_available(line_type& line)
+{
+  while( !next_buffered(line) ) {
+    if( _eof || !buffered() ) return false;
+    if( !fill() ) return next_buffered(line);
+  }
+  return true;
+}
+
+
+bool LineReader::next_bytes(size_t size, line_type& data)
+{
+  while( !next_buffered_bytes(size, data) ) {
+    if( !fill() ) return false;
+  }
+  return true;
+}
+
+
+bool LineReader::next_buffered_bytes(size_t size, line_type& data) noexcept
+{
+  if(_end - _begin < size) return false;
+  data = line_type(_buffer.data() + _begin, size);
+  _begin += size;
+  _scan = std::max(_scan, _begin);
+  return true;
+}
+
+
+bool LineReader::buffered() const
+{
+  if(std::memchr(_buffer.data() + _scan, '\n', _end - _scan) != nullptr) return true;
+  if(_eof) return true;
+  if(_source != nullptr) return _source->in_avail() > 0;
+  pollfd target{ _fd, POLLIN, 0 };
+  return ::poll(&target, 1, 0) > 0;
+}
+
+
+bool LineReader::wait(int timeout) const
+{
+  if(_eof || _source != nullptr) return true;
+  pollfd target{ _fd, POLLIN, 0 };
+  return ::poll(&target, 1, timeout) > 0;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+bool LineReader::fill()
+{
+  if(_eof) return false;
+
+  // Keep the partial line, and make room after it
+  if(_begin > 0) {
+    std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+    _end -= _begin, _scan -= _begin, _begin = 0;
+  }
+  if(_end == _buffer.size()) {
+    _buffer.resize(_buffer.size() * 2);
+  }
+
+  auto size = read_some(_buffer.data() + _end, _buffer.size() - _end);
+  if(size == WOULD_BLOCK) return true;
+  if(size == 0) {
+    _eof = true;
+    return false;
+  }
+  _end += size;
+  return true;
+}
+
+
+size_t LineReader::read_some(char* buffer, size_t size)
+{
+  if(_source != nullptr) {
+    // Take whatever is buffered, or block for a single character
+    auto available = _source->in_avail();
+    auto request = available > 0 ? std::min<std::streamsize>(available, size) : 1;
+    return static_cast<size_t>(_source->sgetn(buffer, request));
+  }
+
+  for(;;) {
+    auto size_read = ::read(_fd, buffer, size);
+    if(size_read >= 0) return static_cast<size_t>(size_read);
+    if(errno == EAGAIN || errno == EWOULDBLOCK) return WOULD_BLOCK;
+    if(errno != EINTR) throw std::system_error(errno, std::generic_category(), "read");
+  }
+}
+
+
+//--------------------------------------------------------
+auto cli::trim_line(LineReader::line_type line) noexcept
+  -> LineReader::line_type
+{
+  while(!line.empty() && std::isspace(static_cast<unsigned char>(line.front()))) line.remove_prefix(1);
+  while(!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.remove_suffix(1);
+  return line;
+}
@@ -0,0 +1,172 @@
+/*!
+ * @file  line_reader.hpp
+ * @brief Buffered line reader for command input
+ */
+#ifndef CLI_BASIC_ENGINE_LINE_READER_HPP
+#define CLI_BASIC_ENGINE_LINE_READER_HPP
+
+#include <streambuf>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+
+
+namespace cli {
+
+  /*!
+   * @brief  Line reader over a file descriptor or a stream buffer
+   * @note   Lines are returned as views into the internal buffer, which is reused
+   *         across reads. A view is valid until the next call of next().
+   * @code
+   * // Usage
+   * LineReader reader( STDIN_FILENO );
+   *
+   * LineReader::line_type line;
+   * while( reader.next(line) ) {
+   *   if( !is_command_line(line) ) continue;
+   *   Command command( trim_line(line).to_string() );
+   * }
+   * @endcode
+   */
+  class LineReader : private boost::noncopyable {
+
+    public:
+    /*!
+     * @typedef  line_type
+     * @brief    Type of a line view
+     */
+    using line_type = boost::string_ref;
+
+    /*!
+     * @var    DEFAULT_BUFFER_SIZE
+     * @brief  Initial size of the read buffer
+     */
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    /*!
+     * @brief      Ctor. with a file descriptor
+     * @param[in]  fd          : readable file descriptor (not owned)
+     * @param[in]  buffer_size : initial buffer size
+     */
+    explicit LineReader(int fd, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /*!
+     * @brief      Ctor. with a stream buffer
+     * @param[in]  source      : stream buffer to read from (not owned)
+     * @param[in]  buffer_size : initial buffer size
+     * @note       Characters available in the source are taken at once, so the ones
+     *             following the last line read are no longer in the source.
+     */
+    explicit LineReader(std::streambuf* source, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /*!
+     * @brief       Read the next line without the line terminator
+     * @param[out]  line : view of the line
+     * @retval      true  : a line is read
+     * @retval      false : the input reached the end
+     * @exception   std::system_error : thrown if reading the file descriptor fails
+     * @note        The last line is returned even if it is not terminated.
+     */
+    bool next(line_type& line);
+
+    /*!
+     * @brief       Take the next line from the buffer without reading the source
+     * @param[out]  line : view of the line
+     * @retval      true  : a complete line, or the last line at the end of input, is taken
+     * @retval      false : more input is required
+     */
+    bool next_buffered(line_type& line) noexcept;
+
+    /*!
+     * @brief       Read the next line only if it is available without blocking
+     * @param[out]  line : view of the line
+     * @retval      false : no complete line is available, or the input reached the end
+     */
+    bool next_available(line_type& line);
+
+    /*!
+     * @brief       Read the next bytes, e.g. a length-prefixed frame
+     * @param[in]   size : the number of bytes
+     * @param[out]  data : view of the bytes
+     * @retval      false : the input reached the end before the bytes
+     * @exception   std::system_error : thrown if reading the file descriptor fails
+     */
+    bool next_bytes(size_t size, line_type& data);
+
+    /*!
+     * @brief       Take the next bytes from the buffer without reading the source
+     * @retval      false : the bytes are not buffered yet
+     */
+    bool next_buffered_bytes(size_t size, line_type& data) noexcept;
+
+    //! Returns view of the buffered input not taken yet
+    line_type peek() const noexcept
+    {
+      return line_type(_buffer.data() + _begin, _end - _begin);
+    }
+
+    /*!
+     * @brief      Read available input into the buffer once
+     * @retval     true  : the input continues (nothing is read if a non-blocking source would block)
+     * @retval     false : the input reached the end
+     * @exception  std::system_error : thrown if reading the file descriptor fails
+     */
+    bool fill();
+
+    /*!
+     * @brief   Check the next line can be read without blocking
+     * @note    It is used to decide when buffered responses have to be flushed.
+     */
+    bool buffered() const;
+
+    /*!
+     * @brief      Wait until the source is readable, i.e. fill() does not block
+     * @param[in]  timeout : the maximum time to wait in milliseconds
+     * @retval     false : the time is out
+     * @note       Stream buffers are always regarded as readable, though fill() may block
+     *             on them; see waitable().
+     */
+    bool wait(int timeout) const;
+
+    //! Check wait() tells when the source is readable, i.e. the source is a file descriptor
+    bool waitable() const noexcept
+    {
+      return _source == nullptr;
+    }
+
+    //! Check the source reached the end
+    bool eof() const noexcept
+    {
+      return _eof;
+    }
+
+
+    private:
+    size_t read_some(char* buffer, size_t size);
+
+    private:
+    int              _fd;
+    std::streambuf*  _source;
+    std::vector<char> _buffer;
+    size_t           _begin;   // head of unconsumed data
+    size_t           _scan;    // data before this offset contains no newline
+    size_t           _end;     // tail of read data
+    bool             _eof;
+
+  };
+
+
+  //! Check the line is a command, i.e. it is neither empty nor a comment
+  inline bool is_command_line(LineReader::line_type line) noexcept
+  {
+    return !line.empty() && line.front() != '#';
+  }
+
+  //! Trim leading and trailing white spaces in place
+  LineReader::line_type trim_line(LineReader::line_type line) noexcept;
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_LINE_READER_HPP */
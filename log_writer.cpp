@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <chrono>
+
+#include <cerrno>
+#include <climits>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "log_writer.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  constexpr size_t MAX_BATCH_SIZE = IOV_MAX;
+  // Records wait at most this long unless the queue is getting full
+  constexpr auto   IDLE_TIMEOUT = std::chrono::milliseconds(10);
+
+  void write_all(int fd, iovec* iov, int count)
+  {
+    while(count > 0) {
+      auto size = ::writev(fd, iov, count);
+      if(size < 0) {
+        if(errno == EINTR) continue;
+        return;  // records are lost rather than blocking the application
+      }
+      // Skip written buffers, and adjust the partially written one
+      auto written = static_cast<size_t>(size);
+      while(count > 0 && written >= iov->iov_len) {
+        written -= iov->iov_len;
+        ++iov, --count;
+      }
+      if(count > 0) {
+        iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+        iov->iov_len -= written;
+      }
+    }
+  }
+
+}
+
+
+AsyncLogWriter::AsyncLogWriter(int fd, size_t queue_size, LogOverflow overflow)
+  : _fd(fd), _overflow(overflow), _queue(queue_size),
+    _num_dropped(0), _num_written(0), _sleeping(false), _stopping(false)
+{
+  _thread = std::thread(&AsyncLogWriter::run, this);
+}
+
+
+AsyncLogWriter::~AsyncLogWriter() noexcept
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _wakeup.notify_one();
+  _thread.join();
+}
+
+
+void AsyncLogWriter::push(std::string&& record)
+{
+  while(!_queue.try_push(std::move(record))) {
+    if(_overflow != LogOverflow::BLOCK) {
+      _num_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    wake_up();
+    std::this_thread::yield();
+  }
+  // Waking the writer for each record would cost more than writing synchronously
+  if(_sleeping.load() && _queue.num_pushed() - _num_written.load() >= _queue.capacity() / 2) wake_up();
+}
+
+
+void AsyncLogWriter::flush()
+{
+  const auto target = _queue.num_pushed();
+  wake_up();
+  std::unique_lock<std::mutex> lock(_mutex);
+  _written.wait(lock, [&]{ return _num_written.load() >= target; });
+}
+
+
+// Private functions
+//--------------------------------------------------------
+void AsyncLogWriter::run()
+{
+  std::vector<std::string> batch;
+  batch.reserve(MAX_BATCH_SIZE);
+  std::string record;
+  for(;;) {
+    while(batch.size() < MAX_BATCH_SIZE && _queue.try_pop(record)) {
+      batch.emplace_back(std::move(record));
+    }
+    if(!batch.empty()) {
+      write_batch(batch);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(_queue.num_pushed() > _num_written.load()) {
+      // A slot is claimed but not published yet
+      lock.unlock();
+      std::this_thread::yield();
+      continue;
+    }
+    if(_stopping) return;
+    _sleeping = true;
+    _wakeup.wait_for(lock, IDLE_TIMEOUT);
+    _sleeping = false;
+  }
+}
+
+
+void AsyncLogWriter::wake_up()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _wakeup.notify_one();
+}
+
+
+void AsyncLogWriter::write_batch(std::vector<std::string>& batch)
+{
+  iovec iov[MAX_BATCH_SIZE];
+  for(size_t i = 0; i < batch.size(); ++i) {
+    iov[i].iov_base = const_cast<char*>(batch[i].data());
+    iov[i].iov_len  = batch[i].size();
+  }
+  write_all(_fd, iov, static_cast<int>(batch.size()));
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _num_written += batch.size();
+  }
+  _written.notify_all();
+  batch.clear();
+}
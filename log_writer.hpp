@@ -0,0 +1,85 @@
+/*!
+ * @file  log_writer.hpp
+ * @brief Background writer of log records
+ */
+#ifndef CLI_BASIC_ENGINE_LOG_WRITER_HPP
+#define CLI_BASIC_ENGINE_LOG_WRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "bounded_queue.hpp"
+
+
+namespace cli {
+
+  //! Policy when the queue of log records is full
+  enum struct LogOverflow {
+    BLOCK,  //!< wait for a free slot
+    DROP,   //!< discard the record
+    COUNT   //!< discard the record, and report the number of discarded records later
+  };
+
+
+  /*!
+   * @brief  Writer thread draining log records from a bounded queue
+   * @note   Records are written with writev in batches.
+   */
+  class AsyncLogWriter : private boost::noncopyable {
+
+    public:
+    /*!
+     * @brief      Ctor. starts the writer thread
+     * @param[in]  fd         : file descriptor to write (not owned)
+     * @param[in]  queue_size : the number of queued records, a power of 2
+     * @param[in]  overflow   : policy when the queue is full
+     */
+    AsyncLogWriter(int fd, size_t queue_size, LogOverflow overflow);
+
+    //! dtor. writes all queued records and joins the thread
+    ~AsyncLogWriter() noexcept;
+
+    /*!
+     * @brief      Queue a record
+     * @param[in]  record : record terminated with a newline
+     */
+    void push(std::string&& record);
+
+    //! Wait until all records queued so far are written
+    void flush();
+
+    //! Returns the number of records discarded so far
+    size_t num_dropped() const noexcept
+    {
+      return _num_dropped.load(std::memory_order_relaxed);
+    }
+
+
+    private:
+    void run();
+    void wake_up();
+    void write_batch(std::vector<std::string>& batch);
+
+    private:
+    int                       _fd;
+    LogOverflow               _overflow;
+    BoundedQueue<std::string> _queue;
+    std::atomic<size_t>       _num_dropped;
+    std::atomic<size_t>       _num_written;
+    std::atomic<bool>         _sleeping;
+    bool                      _stopping;
+    std::mutex                _mutex;
+    std::condition_variable   _wakeup;
+    std::condition_variable   _written;
+    std::thread               _thread;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_LOG_WRITER_HPP */
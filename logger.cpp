@@ -1,17 +1,23 @@
 #include "logger.hpp"
 
-#include <ios>
 #include <iostream>
-#include <boost/format.hpp>
+#include <system_error>
 #include <boost/filesystem.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "timestamp.hpp"
+
 
 using namespace cli;
 
 namespace {
 
-  std::string level_label(LogLevel level)
+  const char* level_label(LogLevel level) noexcept
   {
     switch(level) {
       case LogLevel::DEBUG:
@@ -29,53 +35,72 @@ namespace {
     }
   }
 
-  std::string default_log_dir()
+  //! Write the id, timestamp and label which start a record
+  void write_header(ResponseBuffer& buffer, LogLevel level, TimestampResolution resolution)
   {
-    return boost::filesystem::current_path().string() + "/log";
+    thread_local TimestampFormatter formatter;
+    formatter.set_resolution(resolution);
+    char date[TimestampFormatter::MAX_SIZE];
+    auto date_size = formatter.format(Timestamp::now(), date);
+
+    auto label = level_label(level);
+    auto id    = label[0];
+    buffer << id << " [";
+    buffer.append(date, date_size);
+    buffer << "] " << label << " : ";
   }
 
-  std::string default_log_filename()
-  {
-    auto now  = boost::posix_time::second_clock::local_time();
-    return boost::posix_time::to_iso_extended_string(now) + ".log";
-  }
+}
+
 
+const std::string& Logger::default_log_filename()
+{
+  static const auto filename = boost::posix_time::to_iso_extended_string(
+    boost::posix_time::second_clock::local_time()) + ".log";
+  return filename;
+}
+
+
+const std::string& Logger::default_log_dir()
+{
+  static const auto log_dir = boost::filesystem::current_path().string() + "/log";
+  return log_dir;
 }
 
 
-const std::string Logger::DEFAULT_LOG_DIR      = default_log_dir();
-const std::string Logger::DEFAULT_LOG_FILENAME = default_log_filename();
+// Initialized as constants, so nothing runs at load time
+const Logger::LazyDefault Logger::DEFAULT_LOG_FILENAME(&Logger::default_log_filename);
+const Logger::LazyDefault Logger::DEFAULT_LOG_DIR(&Logger::default_log_dir);
 
 
 Logger::LogStream::LogStream(LogLevel level, Logger& logger)
-  : _out(logger._output_stream.rdbuf())
+  : _logger(&logger), _level(level)
 {
-  auto label = level_label(level);
-  auto id    = label[0];
-  auto date  = boost::posix_time::second_clock::local_time();
-  _buffer << boost::format("%1% [%2%] %3% : ") % id
-                                          % boost::posix_time::to_simple_string(date)
-                                          % label;
+  if(!logger.enabled(level)) {
+    _logger = nullptr;
+    return;
+  }
+  write_header(_buffer, level, logger._resolution);
 }
 
 
 Logger::LogStream::LogStream(LogStream&& stream) noexcept
-  : _out(stream._out.rdbuf())
+  : _buffer(std::move(stream._buffer)), _logger(stream._logger), _level(stream._level)
 {
-  _buffer.copyfmt(stream._buffer);
-  _buffer << stream._buffer.str();
-  stream._out.rdbuf(nullptr);
+  stream._logger = nullptr;
 }
 
 
 Logger::LogStream::~LogStream()
 {
-  _out << _buffer.str() << std::endl;
+  if(_logger != nullptr) _logger->write(_level, _buffer.exchange({}));
 }
 
 
 Logger::Logger()
-  : _output_stream(nullptr)
+  : _fd(-1), _threshold(LogLevel::DEBUG), _resolution(TimestampResolution::MICROSECOND),
+    _queue_size(0), _overflow(LogOverflow::BLOCK),
+    _num_reported_dropped(0), _num_closed_dropped(0)
 {}
 
 
@@ -85,9 +110,22 @@ Logger::~Logger()
 }
 
 
+void Logger::set_timestamp_resolution(TimestampResolution resolution) noexcept
+{
+  _resolution = resolution;
+}
+
+
+void Logger::set_async(size_t queue_size, LogOverflow overflow) noexcept
+{
+  _queue_size = queue_size;
+  _overflow   = overflow;
+}
+
+
 bool Logger::open(const std::string& filename, const std::string& log_dir)
 {
-  if(_file_buffer.is_open()) {
+  if(_fd >= 0) {
     return true;
   }
   auto log_file_path = boost::filesystem::path(log_dir + "/" + filename);
@@ -96,9 +134,13 @@ bool Logger::open(const std::string& filename, const std::string& log_dir)
     if(!boost::filesystem::exists(dir)) {
       boost::filesystem::create_directories(dir);
     }
-    _file_buffer.open(log_file_path.string(), std::ios_base::out | std::ios_base::app);
-    _output_stream.rdbuf(&_file_buffer);
-    _output_stream.clear();
+    _fd = ::open(log_file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(_fd < 0) {
+      throw std::system_error(errno, std::generic_category(), log_file_path.string());
+    }
+    if(_queue_size > 0) {
+      _writer.reset(new AsyncLogWriter(_fd, _queue_size, _overflow));
+    }
   } catch(const std::exception& e) {
     std::cerr << e.what() << std::endl;
     return false;
@@ -111,13 +153,42 @@ bool Logger::open(const std::string& filename, const std::string& log_dir)
 void Logger::close()
 {
   info() << "Closed";
-  if(_file_buffer.is_open()) {
-    _file_buffer.close();
-    _output_stream.rdbuf(nullptr);
+  if(_writer) {
+    _num_closed_dropped += _writer->num_dropped();
+    _num_reported_dropped = 0;
+    _writer.reset();
+  }
+  if(_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
   }
 }
 
 
+void Logger::flush()
+{
+  if(_writer) _writer->flush();
+}
+
+
+size_t Logger::num_dropped() const noexcept
+{
+  return _num_closed_dropped + (_writer ? _writer->num_dropped() : 0);
+}
+
+
+void Logger::set_threshold(LogLevel level) noexcept
+{
+  _threshold = level;
+}
+
+
+auto Logger::stream(LogLevel level) -> LogStream
+{
+  return LogStream(level, *this);
+}
+
+
 auto Logger::debug() -> LogStream
 {
   return LogStream(LogLevel::DEBUG, *this);
@@ -146,3 +217,32 @@ auto Logger::fatal() -> LogStream
 {
   return LogStream(LogLevel::FATAL, *this);
 }
+
+
+// Private functions
+//--------------------------------------------------------
+void Logger::write(LogLevel level, std::string record)
+{
+  if(_fd < 0) return;
+  record += '\n';
+
+  if(!_writer) {
+    auto written = ::write(_fd, record.data(), record.size());
+    (void)written;
+    return;
+  }
+
+  if(_overflow == LogOverflow::COUNT) {
+    auto dropped  = _writer->num_dropped();
+    auto reported = _num_reported_dropped.load();
+    if(dropped > reported && _num_reported_dropped.compare_exchange_strong(reported, dropped)) {
+      // Pushed directly, as the threshold would filter a warning out
+      ResponseBuffer report;
+      write_header(report, LogLevel::WARNING, _resolution);
+      report << dropped - reported << " log records were dropped\n";
+      _writer->push(report.exchange({}));
+    }
+  }
+  _writer->push(std::move(record));
+  if(level == LogLevel::FATAL) _writer->flush();
+}
@@ -1,9 +1,36 @@
 #ifndef CLI_BASIC_ENGINE_LOGGER_HPP
 #define CLI_BASIC_ENGINE_LOGGER_HPP
 
-#include <ostream>
-#include <sstream>
-#include <fstream>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "log_writer.hpp"
+#include "response_buffer.hpp"
+#include "timestamp.hpp"
+
+
+/*!
+ * @def    CLI_LOG_MIN_LEVEL
+ * @brief  Records below this level are removed at compile time, e.g. -DCLI_LOG_MIN_LEVEL=INFO
+ */
+#ifndef CLI_LOG_MIN_LEVEL
+#define CLI_LOG_MIN_LEVEL DEBUG
+#endif
+
+/*!
+ * @def    CLI_LOG
+ * @brief  Write a record only if the level is enabled
+ * @note   Operands of operator<< are not evaluated for a filtered record.
+ * @code
+ * // Usage
+ * CLI_LOG(logger(), INFO) << "Accept command: " << command.raw_string();
+ * @endcode
+ */
+#define CLI_LOG(logger, level) \
+  !(static_cast<int>(::cli::LogLevel::level) >= static_cast<int>(::cli::LogLevel::CLI_LOG_MIN_LEVEL) && \
+    (logger).enabled(::cli::LogLevel::level)) \
+    ? (void)0 : ::cli::Logger::Voidify() & (logger).stream(::cli::LogLevel::level)
 
 
 namespace cli {
@@ -16,8 +43,48 @@ namespace cli {
   class Logger {
 
     public:
-    static const std::string DEFAULT_LOG_FILENAME;
-    static const std::string DEFAULT_LOG_DIR;
+    /*!
+     * @brief   Returns the default name of log files, the local time of the first call
+     * @note    It is made on the first call rather than at load time, so processes which
+     *          never open the default log do not read the time zone.
+     */
+    static const std::string& default_log_filename();
+
+    //! Returns the default directory of log files, 'log' in the working directory of the first call
+    static const std::string& default_log_dir();
+
+    /*!
+     * @brief  Default path made on first use
+     * @note   It converts to const std::string&; call str() where the conversion does not
+     *         apply, e.g. templates such as operator+ of std::string.
+     */
+    class LazyDefault {
+
+      public:
+      constexpr explicit LazyDefault(const std::string& (*make)()) noexcept
+        : _make(make)
+      {
+      }
+
+      const std::string& str() const
+      {
+        return _make();
+      }
+
+      operator const std::string&() const
+      {
+        return _make();
+      }
+
+      private:
+      const std::string& (*_make)();
+
+    };
+
+    //! Same as default_log_filename()
+    static const LazyDefault DEFAULT_LOG_FILENAME;
+    //! Same as default_log_dir()
+    static const LazyDefault DEFAULT_LOG_DIR;
 
     class LogStream {
 
@@ -30,23 +97,62 @@ namespace cli {
       template<class T>
       LogStream& operator<<(const T& output)
       {
-        _buffer << output;
+        if(_logger != nullptr) _buffer << output;
         return *this;
       }
 
       private:
-      std::ostringstream _buffer;
-      std::ostream       _out;
+      ResponseBuffer     _buffer;
+      Logger*            _logger;   // null if the record is filtered
+      LogLevel           _level;
+
+    };
 
+    //! Helper of CLI_LOG to discard the stream in a conditional expression
+    struct Voidify {
+      void operator&(const LogStream&) const noexcept {}
     };
 
     Logger();
     ~Logger();
 
+    //! Change the resolution of timestamps in records [default = microsecond]
+    void set_timestamp_resolution(TimestampResolution resolution) noexcept;
+
+    /*!
+     * @brief      Write records on a background thread
+     * @param[in]  queue_size : the number of queued records, a power of 2 (0 for synchronous writes)
+     * @param[in]  overflow   : policy when the queue is full
+     * @note       It takes effect at the next open(). Fatal records and close() wait
+     *             until the queued records are written.
+     */
+    void set_async(size_t queue_size, LogOverflow overflow = LogOverflow::BLOCK) noexcept;
+
     bool open(const std::string& filename = DEFAULT_LOG_FILENAME,
               const std::string& log_dir = DEFAULT_LOG_DIR);
     void close();
 
+    //! Wait until all records are written
+    void flush();
+
+    /*!
+     * @brief      Set the minimum level of records written [default = LogLevel::DEBUG]
+     * @note       Records below CLI_LOG_MIN_LEVEL are removed from CLI_LOG at compile time.
+     */
+    void set_threshold(LogLevel level) noexcept;
+
+    //! Check records of the level are written
+    bool enabled(LogLevel level) const noexcept
+    {
+      return _fd >= 0 && static_cast<int>(level) >= static_cast<int>(_threshold);
+    }
+
+    //! Returns a stream of a record; prefer CLI_LOG to skip building filtered records
+    LogStream stream(LogLevel level);
+
+    //! Returns the number of records discarded by the overflow policy
+    size_t num_dropped() const noexcept;
+
     LogStream debug();
     LogStream info();
     LogStream warning();
@@ -54,8 +160,17 @@ namespace cli {
     LogStream fatal();
 
     private:
-    std::ostream _output_stream;
-    std::filebuf _file_buffer;
+    void write(LogLevel level, std::string record);
+
+    private:
+    int         _fd;
+    LogLevel    _threshold;
+    TimestampResolution _resolution;
+    size_t      _queue_size;
+    LogOverflow _overflow;
+    std::atomic<size_t> _num_reported_dropped;
+    size_t      _num_closed_dropped;
+    std::unique_ptr<AsyncLogWriter> _writer;
 
   };
 
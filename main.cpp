@@ -1,17 +1,48 @@
 #include <iostream>
 #include <exception>
 
+#include <csignal>
+
+#include <unistd.h>
+
 #include "engine.hpp"
 
 
 using cli::Engine;
 
+namespace {
+
+  Engine* running_engine = nullptr;
+
+  void stop_engine(int)
+  {
+    if(running_engine != nullptr) running_engine->stop();
+  }
+
+}
+
 int main(int argc, char const* argv[])
 {
+  // Safe, as stdin is read through the fd line reader rather than iostreams
+  std::ios_base::sync_with_stdio(false);
+
   Engine engine;
   engine.initialize(argc, argv);
   try {
-    engine.main_loop( std::cin, std::cout );
+    const auto& options = engine.parsed_options();
+    if(options.count("replay")) {
+      return engine.replay( options["replay"].as<std::string>(), std::cout );
+    }
+    if(options.count("script")) {
+      return engine.run_script( options["script"].as<std::string>(), std::cout );
+    }
+    if(options.count("socket")) {
+      running_engine = &engine;
+      std::signal(SIGINT, &stop_engine);
+      std::signal(SIGTERM, &stop_engine);
+      return engine.serve( options["socket"].as<std::string>() );
+    }
+    engine.main_loop( STDIN_FILENO, std::cout );
   } catch(const std::exception& e) {
     std::cerr << e.what() << std::endl;
     return EXIT_FAILURE;
@@ -0,0 +1,68 @@
+#include <system_error>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  size_t page_size() noexcept
+  {
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
+}
+
+
+MappedFile::MappedFile(const std::string& path)
+  : _data(nullptr), _size(0), _released(0)
+{
+  auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+  struct stat status;
+  if(::fstat(fd, &status) != 0) {
+    const auto error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), path);
+  }
+  _size = static_cast<size_t>(status.st_size);
+
+  // Empty files cannot be mapped, and need not be
+  if(_size > 0) {
+    auto data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) {
+      const auto error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), path);
+    }
+    _data = static_cast<const char*>(data);
+    ::madvise(data, _size, MADV_SEQUENTIAL);
+  }
+  // The mapping keeps the file open
+  ::close(fd);
+}
+
+
+MappedFile::~MappedFile() noexcept
+{
+  if(_data != nullptr) ::munmap(const_cast<char*>(_data), _size);
+}
+
+
+void MappedFile::release(size_t offset) noexcept
+{
+  if(offset < _released + RELEASE_SIZE) return;
+  const auto end = offset / page_size() * page_size();
+  ::madvise(const_cast<char*>(_data) + _released, end - _released, MADV_DONTNEED);
+  _released = end;
+}
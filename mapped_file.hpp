@@ -0,0 +1,72 @@
+/*!
+ * @file  mapped_file.hpp
+ * @brief Read-only memory mapping of files read sequentially
+ */
+#ifndef CLI_BASIC_ENGINE_MAPPED_FILE_HPP
+#define CLI_BASIC_ENGINE_MAPPED_FILE_HPP
+
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+
+
+namespace cli {
+
+  /*!
+   * @brief  Read-only file mapped into memory for a sequential scan
+   * @note   The kernel is advised to read ahead and to drop pages behind the scan,
+   *         and release() drops the pages already scanned, so that files larger
+   *         than the physical memory do not evict other pages.
+   * @code
+   * // Usage
+   * MappedFile file( "commands.txt" );
+   * auto data = file.data();
+   * for(size_t offset = 0; offset < data.size(); ) {
+   *   ...
+   *   file.release(offset);
+   * }
+   * @endcode
+   */
+  class MappedFile : private boost::noncopyable {
+
+    public:
+    /*!
+     * @var    RELEASE_SIZE
+     * @brief  Scanned pages are dropped in chunks of this size
+     */
+    static constexpr size_t RELEASE_SIZE = 64 * 1024 * 1024;
+
+    /*!
+     * @brief      Ctor. maps the whole file
+     * @param[in]  path : path of the file
+     * @exception  std::system_error : thrown if the file cannot be opened or mapped
+     */
+    explicit MappedFile(const std::string& path);
+
+    //! dtor. unmaps the file
+    ~MappedFile() noexcept;
+
+    //! Returns view of the file content
+    boost::string_ref data() const noexcept
+    {
+      return boost::string_ref(_data, _size);
+    }
+
+    /*!
+     * @brief      Drop the pages before the offset, once a chunk of them is scanned
+     * @param[in]  offset : the content before it is not accessed any more
+     */
+    void release(size_t offset) noexcept;
+
+    private:
+    const char* _data;
+    size_t      _size;
+    size_t      _released;  // the pages before this offset are dropped
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_MAPPED_FILE_HPP */
@@ -0,0 +1,75 @@
+#include "protocol.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  void put_u32(std::string& output, uint32_t value)
+  {
+    char bytes[4];
+    for(size_t i = 0; i < sizeof(bytes); ++i) bytes[i] = static_cast<char>(value >> (8 * i));
+    output.append(bytes, sizeof(bytes));
+  }
+
+  //! Take a u32 from the head of the input
+  bool take_u32(boost::string_ref& input, uint32_t& value) noexcept
+  {
+    if(input.size() < 4) return false;
+    value = frame::payload_size(input.data());
+    input.remove_prefix(4);
+    return true;
+  }
+
+}
+
+
+bool frame::decode_request(boost::string_ref payload, std::vector<boost::string_ref>& tokens)
+{
+  tokens.clear();
+  uint32_t num_tokens;
+  if(!take_u32(payload, num_tokens) || num_tokens > payload.size() / 4) return false;
+  for(uint32_t i = 0; i < num_tokens; ++i) {
+    uint32_t size;
+    if(!take_u32(payload, size) || size > payload.size()) return false;
+    tokens.emplace_back(payload.data(), size);
+    payload.remove_prefix(size);
+  }
+  return payload.empty();
+}
+
+
+void frame::encode_request(const std::vector<boost::string_ref>& tokens, std::string& output)
+{
+  size_t size = 4;
+  for(auto token : tokens) size += 4 + token.size();
+  put_u32(output, static_cast<uint32_t>(size));
+  put_u32(output, static_cast<uint32_t>(tokens.size()));
+  for(auto token : tokens) {
+    put_u32(output, static_cast<uint32_t>(token.size()));
+    output.append(token.data(), token.size());
+  }
+}
+
+
+void frame::write_response(std::ostream& os, ResponseStatus status, boost::string_ref response)
+{
+  char header[HEADER_SIZE + 1];
+  const auto size = static_cast<uint32_t>(response.size() + 1);
+  for(size_t i = 0; i < HEADER_SIZE; ++i) header[i] = static_cast<char>(size >> (8 * i));
+  header[HEADER_SIZE] = static_cast<char>(status);
+  os.write(header, sizeof(header));
+  os.write(response.data(), response.size());
+}
+
+
+bool frame::decode_response(boost::string_ref& input, ResponseStatus& status, boost::string_ref& response)
+{
+  auto rest = input;
+  uint32_t size;
+  if(!take_u32(rest, size) || size == 0 || size > rest.size()) return false;
+  status   = static_cast<ResponseStatus>(rest[0]);
+  response = rest.substr(1, size - 1);
+  input    = rest.substr(size);
+  return true;
+}
@@ -0,0 +1,84 @@
+/*!
+ * @file  protocol.hpp
+ * @brief Length-prefixed binary framing of commands and responses
+ */
+#ifndef CLI_BASIC_ENGINE_PROTOCOL_HPP
+#define CLI_BASIC_ENGINE_PROTOCOL_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace cli {
+
+  //! Framing of commands and responses
+  enum struct Protocol {
+    TEXT,   //!< '>' prompts, '='/'?' prefixed responses terminated by EOT
+    BINARY  //!< length-prefixed frames
+  };
+
+  //! Status of responses
+  enum struct ResponseStatus : uint8_t {
+    ACCEPTED = 0, FAILED = 1, ABORTED = 2
+  };
+
+  /*!
+   * @brief  Binary frames switched to by the 'protocol binary' command
+   * @note   All integers are unsigned little endian. No prompt nor EOT is written.
+   * @code
+   * request  : u32 payload_size | u32 num_tokens | (u32 token_size | token)...
+   * response : u32 payload_size | u8 status | response
+   * @endcode
+   * The first token is the command name, and the others are its arguments, which
+   * may contain white spaces.
+   */
+  namespace frame {
+
+    //! Size of the length prefix
+    constexpr size_t HEADER_SIZE = 4;
+
+    //! Frames larger than this are rejected
+    constexpr uint32_t MAX_PAYLOAD_SIZE = 1u << 30;
+
+    //! Read the length prefix
+    inline uint32_t payload_size(const char* header) noexcept
+    {
+      uint32_t size = 0;
+      for(size_t i = 0; i < HEADER_SIZE; ++i) {
+        size |= static_cast<uint32_t>(static_cast<unsigned char>(header[i])) << (8 * i);
+      }
+      return size;
+    }
+
+    /*!
+     * @brief       Decode the tokens of a request payload
+     * @param[out]  tokens : views into the payload
+     * @retval      false  : the payload is malformed
+     */
+    bool decode_request(boost::string_ref payload, std::vector<boost::string_ref>& tokens);
+
+    //! Append a request frame of the tokens
+    void encode_request(const std::vector<boost::string_ref>& tokens, std::string& output);
+
+    //! Write a response frame
+    void write_response(std::ostream& os, ResponseStatus status, boost::string_ref response);
+
+    /*!
+     * @brief          Decode a response frame at the head of the input
+     * @param[in,out]  input    : the frame is removed on success
+     * @param[out]     status   : status of the response
+     * @param[out]     response : view of the response in the input
+     * @retval         false    : no complete frame is in the input, or it is malformed
+     */
+    bool decode_response(boost::string_ref& input, ResponseStatus& status, boost::string_ref& response);
+
+  }
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_PROTOCOL_HPP */
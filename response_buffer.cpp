@@ -0,0 +1,216 @@
+#include <streambuf>
+
+#include <cstdio>
+
+#include "response_buffer.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  // Same as the default format of std::ostream
+  constexpr int DEFAULT_PRECISION = 6;
+
+  char* format_digits(unsigned long long value, char* tail) noexcept
+  {
+    do {
+      *--tail = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while(value != 0);
+    return tail;
+  }
+
+}
+
+
+//! Stream appending to the storage of the buffer without a put area
+class ResponseBuffer::Stream : public std::ostream {
+
+  public:
+  explicit Stream(storage_type* storage)
+    : std::ostream(nullptr), _buffer(storage)
+  {
+    rdbuf(&_buffer);
+  }
+
+  //! Append to the storage moved to another buffer
+  void retarget(storage_type* storage) noexcept
+  {
+    _buffer.storage = storage;
+  }
+
+  private:
+  struct Buffer : public std::streambuf {
+    explicit Buffer(storage_type* target) noexcept
+      : storage(target)
+    {
+    }
+
+    int_type overflow(int_type c) override
+    {
+      if(!traits_type::eq_int_type(c, traits_type::eof())) storage->push_back(traits_type::to_char_type(c));
+      return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override
+    {
+      storage->append(data, static_cast<size_t>(size));
+      return size;
+    }
+
+    storage_type* storage;
+  };
+
+  Buffer _buffer;
+
+};
+
+
+ResponseBuffer::ResponseBuffer() noexcept = default;
+
+
+ResponseBuffer::ResponseBuffer(storage_type storage) noexcept
+  : _storage(std::move(storage))
+{
+  _storage.clear();
+}
+
+
+ResponseBuffer::ResponseBuffer(ResponseBuffer&& buffer) noexcept
+  : _storage(std::move(buffer._storage)), _stream(std::move(buffer._stream))
+{
+  if(_stream) _stream->retarget(&_storage);
+}
+
+
+ResponseBuffer& ResponseBuffer::operator=(ResponseBuffer&& buffer) noexcept
+{
+  _storage = std::move(buffer._storage);
+  _stream  = std::move(buffer._stream);
+  if(_stream) _stream->retarget(&_storage);
+  return *this;
+}
+
+
+ResponseBuffer::~ResponseBuffer() noexcept = default;
+
+
+std::ostream& ResponseBuffer::stream()
+{
+  if(!_stream) _stream.reset(new Stream(&_storage));
+  return *_stream;
+}
+
+
+std::ios_base::fmtflags ResponseBuffer::flags() const noexcept
+{
+  return _stream ? _stream->flags() : std::ios_base::skipws | std::ios_base::dec;
+}
+
+
+std::streamsize ResponseBuffer::precision() const noexcept
+{
+  return _stream ? _stream->precision() : DEFAULT_PRECISION;
+}
+
+
+std::streamsize ResponseBuffer::width() const noexcept
+{
+  return _stream ? _stream->width() : 0;
+}
+
+
+char ResponseBuffer::fill() const noexcept
+{
+  return _stream ? _stream->fill() : ' ';
+}
+
+
+ResponseBuffer& ResponseBuffer::operator<<(double value)
+{
+  if(formatted()) return insert(value);
+  char buffer[32];
+  auto size = std::snprintf(buffer, sizeof(buffer), "%.*g", DEFAULT_PRECISION, value);
+  return append(buffer, static_cast<size_t>(size));
+}
+
+
+ResponseBuffer& ResponseBuffer::operator<<(long double value)
+{
+  if(formatted()) return insert(value);
+  char buffer[64];
+  auto size = std::snprintf(buffer, sizeof(buffer), "%.*Lg", DEFAULT_PRECISION, value);
+  return append(buffer, static_cast<size_t>(size));
+}
+
+
+ResponseBuffer& ResponseBuffer::operator<<(std::ostream& (*manipulator)(std::ostream&))
+{
+  manipulator(stream());
+  return *this;
+}
+
+
+ResponseBuffer& ResponseBuffer::operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+{
+  manipulator(stream());
+  return *this;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+bool ResponseBuffer::default_format() const noexcept
+{
+  return _stream->flags() == (std::ios_base::skipws | std::ios_base::dec) &&
+         _stream->width() == 0 && _stream->precision() == DEFAULT_PRECISION;
+}
+
+
+void ResponseBuffer::reset_format() noexcept
+{
+  _stream->flags(std::ios_base::skipws | std::ios_base::dec);
+  _stream->width(0);
+  _stream->precision(DEFAULT_PRECISION);
+  _stream->fill(' ');
+  _stream->clear();
+}
+
+
+ResponseBuffer& ResponseBuffer::append_integer(long long value)
+{
+  char buffer[24];
+  auto tail = buffer + sizeof(buffer);
+  auto magnitude = value < 0 ? 0ull - static_cast<unsigned long long>(value)
+                             : static_cast<unsigned long long>(value);
+  auto head = format_digits(magnitude, tail);
+  if(value < 0) *--head = '-';
+  return append(head, tail - head);
+}
+
+
+ResponseBuffer& ResponseBuffer::append_integer(unsigned long long value)
+{
+  char buffer[24];
+  auto tail = buffer + sizeof(buffer);
+  auto head = format_digits(value, tail);
+  return append(head, tail - head);
+}
+
+
+//--------------------------------------------------------
+auto ResponsePool::acquire() -> storage_type
+{
+  if(_free_list.empty()) return storage_type();
+  auto storage = std::move(_free_list.back());
+  _free_list.pop_back();
+  return storage;
+}
+
+
+void ResponsePool::release(storage_type storage)
+{
+  storage.clear();
+  _free_list.emplace_back(std::move(storage));
+}
@@ -0,0 +1,319 @@
+/*!
+ * @file  response_buffer.hpp
+ * @brief Append-only response buffer
+ */
+#ifndef CLI_BASIC_ENGINE_RESPONSE_BUFFER_HPP
+#define CLI_BASIC_ENGINE_RESPONSE_BUFFER_HPP
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+
+
+namespace cli {
+
+  /*!
+   * @brief  Append-only buffer to build responses
+   * @note   It accepts the same insertions and members as std::ostringstream. Strings
+   *         and numbers in the default format are appended without a locale;
+   *         manipulators, other formats and other types go through a std::ostream
+   *         writing to the same buffer, which is made on first use. clear() restores
+   *         the default format.
+   * @code
+   * // Usage
+   * ResponseBuffer buffer;
+   * buffer << "value: " << 42 << ' ' << 0.5 << ' ' << std::hex << 255;
+   * assert( buffer.str() == "value: 42 0.5 ff" );
+   *
+   * void write_table(std::ostream&);
+   * write_table( buffer );  // as a std::ostream
+   * @endcode
+   */
+  class ResponseBuffer {
+
+    public:
+    /*!
+     * @typedef  storage_type
+     * @brief    Type of the underlying storage
+     */
+    using storage_type = std::string;
+
+    //! Default ctor.
+    ResponseBuffer() noexcept;
+
+    //! Ctor. with storage whose capacity is reused
+    explicit ResponseBuffer(storage_type storage) noexcept;
+
+    //! Move ctor.; the format is moved with the content
+    ResponseBuffer(ResponseBuffer&& buffer) noexcept;
+
+    //! Move operator
+    ResponseBuffer& operator=(ResponseBuffer&& buffer) noexcept;
+
+    //! dtor.
+    ~ResponseBuffer() noexcept;
+
+    /*!
+     * @brief   Returns a std::ostream writing to the buffer
+     * @note    Its format flags, width and precision apply to the following insertions.
+     */
+    std::ostream& stream();
+
+    //! Use the buffer as a std::ostream
+    operator std::ostream&()
+    {
+      return stream();
+    }
+
+    //! Returns the content
+    const storage_type& str() const noexcept
+    {
+      return _storage;
+    }
+
+    //! Replace the content, keeping the format
+    void str(boost::string_ref content)
+    {
+      _storage.assign(content.data(), content.size());
+    }
+
+    //! Returns the size of the content
+    size_t size() const noexcept
+    {
+      return _storage.size();
+    }
+
+    //! Check the buffer is empty
+    bool empty() const noexcept
+    {
+      return _storage.empty();
+    }
+
+    //! Clear the content and the format, keeping the capacity
+    void clear() noexcept
+    {
+      _storage.clear();
+      if(_stream) reset_format();
+    }
+
+    //! Append raw characters
+    ResponseBuffer& append(const char* data, size_t size)
+    {
+      _storage.append(data, size);
+      return *this;
+    }
+
+    // Members of std::ostream
+    //--------------------------------------------------------
+    //! Append raw characters, ignoring the format
+    ResponseBuffer& write(const char* data, std::streamsize size)
+    {
+      return append(data, static_cast<size_t>(size));
+    }
+
+    //! Append a character, ignoring the format
+    ResponseBuffer& put(char c)
+    {
+      _storage.push_back(c);
+      return *this;
+    }
+
+    //! Nothing to do, as the content is not buffered elsewhere
+    ResponseBuffer& flush() noexcept
+    {
+      return *this;
+    }
+
+    //! Returns the output position, which is the size of the content
+    std::streampos tellp() const noexcept
+    {
+      return static_cast<std::streamoff>(_storage.size());
+    }
+
+    std::ios_base::fmtflags flags() const noexcept;
+    std::ios_base::fmtflags flags(std::ios_base::fmtflags flags)
+    {
+      return stream().flags(flags);
+    }
+
+    std::ios_base::fmtflags setf(std::ios_base::fmtflags flags)
+    {
+      return stream().setf(flags);
+    }
+
+    std::ios_base::fmtflags setf(std::ios_base::fmtflags flags, std::ios_base::fmtflags mask)
+    {
+      return stream().setf(flags, mask);
+    }
+
+    void unsetf(std::ios_base::fmtflags flags)
+    {
+      stream().unsetf(flags);
+    }
+
+    std::streamsize precision() const noexcept;
+    std::streamsize precision(std::streamsize precision)
+    {
+      return stream().precision(precision);
+    }
+
+    std::streamsize width() const noexcept;
+    std::streamsize width(std::streamsize width)
+    {
+      return stream().width(width);
+    }
+
+    char fill() const noexcept;
+    char fill(char c)
+    {
+      return stream().fill(c);
+    }
+
+    /*!
+     * @brief      Replace the storage
+     * @param[in]  storage : storage whose capacity is reused
+     * @return     the previous storage
+     */
+    storage_type exchange(storage_type storage) noexcept
+    {
+      std::swap(_storage, storage);
+      _storage.clear();
+      return storage;
+    }
+
+    // Insert operators
+    //--------------------------------------------------------
+    ResponseBuffer& operator<<(char value)
+    {
+      if(formatted()) return insert(value);
+      _storage.push_back(value);
+      return *this;
+    }
+
+    ResponseBuffer& operator<<(signed char value)
+    {
+      return *this << static_cast<char>(value);
+    }
+
+    ResponseBuffer& operator<<(unsigned char value)
+    {
+      return *this << static_cast<char>(value);
+    }
+
+    ResponseBuffer& operator<<(const char* value)
+    {
+      if(formatted()) return insert(value);
+      _storage.append(value);
+      return *this;
+    }
+
+    ResponseBuffer& operator<<(const std::string& value)
+    {
+      if(formatted()) return insert(value);
+      _storage.append(value);
+      return *this;
+    }
+
+    ResponseBuffer& operator<<(boost::string_ref value)
+    {
+      if(formatted()) return insert(value);
+      return append(value.data(), value.size());
+    }
+
+    template<class T>
+    auto operator<<(T value)
+      -> typename std::enable_if<std::is_integral<T>::value, ResponseBuffer&>::type
+    {
+      if(formatted()) return insert(value);
+      return std::is_signed<T>::value ? append_integer(static_cast<long long>(value))
+                                      : append_integer(static_cast<unsigned long long>(value));
+    }
+
+    ResponseBuffer& operator<<(double value);
+    ResponseBuffer& operator<<(long double value);
+    ResponseBuffer& operator<<(float value)
+    {
+      return *this << static_cast<double>(value);
+    }
+
+    //! Fallback to operator<< for std::ostream, e.g. std::setw(4)
+    template<class T>
+    auto operator<<(const T& value)
+      -> typename std::enable_if<!std::is_arithmetic<T>::value &&
+                                 !std::is_convertible<const T&, boost::string_ref>::value,
+                                 ResponseBuffer&>::type
+    {
+      return insert(value);
+    }
+
+    //! Manipulators such as std::endl
+    ResponseBuffer& operator<<(std::ostream& (*manipulator)(std::ostream&));
+
+    //! Manipulators of the format such as std::hex
+    ResponseBuffer& operator<<(std::ios_base& (*manipulator)(std::ios_base&));
+
+
+    private:
+    class Stream;
+
+    //! Check the stream has a format other than the default
+    bool formatted() const noexcept
+    {
+      return _stream && !default_format();
+    }
+
+    template<class T>
+    ResponseBuffer& insert(const T& value)
+    {
+      stream() << value;
+      return *this;
+    }
+
+    bool default_format() const noexcept;
+    void reset_format() noexcept;
+    ResponseBuffer& append_integer(long long value);
+    ResponseBuffer& append_integer(unsigned long long value);
+
+    private:
+    storage_type            _storage;
+    std::unique_ptr<Stream> _stream;  // made on first use
+
+  };
+
+
+  /*!
+   * @brief  Pool of response storage reused across commands
+   * @note   It is not thread safe; acquire and release on the dispatching thread.
+   * @code
+   * // Usage
+   * ResponsePool pool;
+   * ResponseBuffer buffer( pool.acquire() );
+   * buffer << "response";
+   * pool.release( buffer.exchange({}) );
+   * @endcode
+   */
+  class ResponsePool : private boost::noncopyable {
+
+    public:
+    using storage_type = ResponseBuffer::storage_type;
+
+    //! Returns a storage, reusing the released one if any
+    storage_type acquire();
+
+    //! Returns a storage to the pool
+    void release(storage_type storage);
+
+    private:
+    std::vector<storage_type> _free_list;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_RESPONSE_BUFFER_HPP */
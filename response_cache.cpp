@@ -0,0 +1,123 @@
+#include "response_cache.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  void append_size(std::string& key, size_t size)
+  {
+    char bytes[4];
+    for(size_t i = 0; i < sizeof(bytes); ++i) bytes[i] = static_cast<char>(size >> (8 * i));
+    key.append(bytes, sizeof(bytes));
+  }
+
+  //! Append the size-prefixed and case-folded name, which is the head of the keys of the command
+  void append_name(std::string& key, boost::string_ref name)
+  {
+    append_size(key, name.size());
+    for(auto c : name) key += ('A' <= c && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+  }
+
+}
+
+
+ResponseCache::ResponseCache(size_t capacity)
+  : _capacity(capacity), _hits(0), _misses(0)
+{
+}
+
+
+void ResponseCache::set_capacity(size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _capacity = capacity;
+  evict();
+}
+
+
+size_t ResponseCache::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _entries.size();
+}
+
+
+void ResponseCache::make_key(const Command& command, std::string& key)
+{
+  // Tokens are prefixed by their sizes, since they may contain any character
+  key.clear();
+  append_name(key, command.name_view());
+  for(size_t i = 0; i < command.num_arguments(); ++i) {
+    const auto argument = command.argument_view(i);
+    append_size(key, argument.size());
+    key.append(argument.data(), argument.size());
+  }
+}
+
+
+bool ResponseCache::find(const std::string& key, ResponseBuffer& response)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto found = _index.find(key);
+  if(found == _index.end()) {
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  _entries.splice(_entries.begin(), _entries, found->second);
+  response << found->second->second;
+  _hits.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+
+void ResponseCache::insert(const std::string& key, boost::string_ref response)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_capacity == 0) return;
+  auto found = _index.find(key);
+  if(found != _index.end()) {
+    found->second->second.assign(response.data(), response.size());
+    _entries.splice(_entries.begin(), _entries, found->second);
+    return;
+  }
+  _entries.emplace_front(key, response.to_string());
+  _index.emplace(key, _entries.begin());
+  evict();
+}
+
+
+void ResponseCache::invalidate()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _entries.clear();
+  _index.clear();
+}
+
+
+void ResponseCache::invalidate(boost::string_ref name)
+{
+  std::string prefix;
+  append_name(prefix, name);
+  std::lock_guard<std::mutex> lock(_mutex);
+  for(auto ite = _entries.begin(); ite != _entries.end(); ) {
+    const auto& key = ite->first;
+    if(key.compare(0, prefix.size(), prefix) == 0) {
+      _index.erase(key);
+      ite = _entries.erase(ite);
+    } else {
+      ++ite;
+    }
+  }
+}
+
+
+// Private functions
+//--------------------------------------------------------
+void ResponseCache::evict()
+{
+  while(_entries.size() > _capacity) {
+    _index.erase(_entries.back().first);
+    _entries.pop_back();
+  }
+}
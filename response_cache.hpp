@@ -0,0 +1,114 @@
+/*!
+ * @file  response_cache.hpp
+ * @brief Bounded LRU cache of rendered responses
+ */
+#ifndef CLI_BASIC_ENGINE_RESPONSE_CACHE_HPP
+#define CLI_BASIC_ENGINE_RESPONSE_CACHE_HPP
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "command.hpp"
+#include "response_buffer.hpp"
+
+
+namespace cli {
+
+  /*!
+   * @brief  Cache of responses keyed by normalized commands
+   * @note   The least recently used response is evicted when the cache is full.
+   *         All the operations lock a mutex, since concurrent commands share the cache.
+   * @code
+   * // Usage
+   * ResponseCache cache( 1024 );
+   * std::string key;
+   * ResponseCache::make_key( command, key );
+   * if( !cache.find(key, command.response_stream()) ) {
+   *   run( command );
+   *   cache.insert( key, command.response() );
+   * }
+   * @endcode
+   */
+  class ResponseCache : private boost::noncopyable {
+
+    public:
+    /*!
+     * @brief      Ctor.
+     * @param[in]  capacity : the maximum number of responses; 0 disables the cache
+     */
+    explicit ResponseCache(size_t capacity = 0);
+
+    //! Change the capacity, evicting responses over it
+    void set_capacity(size_t capacity);
+
+    //! Returns the maximum number of responses
+    size_t capacity() const noexcept
+    {
+      return _capacity;
+    }
+
+    //! Returns the number of cached responses
+    size_t size() const;
+
+    /*!
+     * @brief       Build the key of a command
+     * @param[in]   command : the name is case-folded, and the arguments are kept as they are
+     * @param[out]  key     : its storage is reused
+     */
+    static void make_key(const Command& command, std::string& key);
+
+    /*!
+     * @brief       Append the cached response to the buffer
+     * @retval      false : the response is not cached
+     * @note        It counts a hit or a miss.
+     */
+    bool find(const std::string& key, ResponseBuffer& response);
+
+    //! Cache the response as the most recently used one
+    void insert(const std::string& key, boost::string_ref response);
+
+    //! Remove all the responses
+    void invalidate();
+
+    //! Remove the responses of the command
+    void invalidate(boost::string_ref name);
+
+    //! Returns the number of find() which found responses
+    uint64_t hits() const noexcept
+    {
+      return _hits.load(std::memory_order_relaxed);
+    }
+
+    //! Returns the number of find() which found nothing
+    uint64_t misses() const noexcept
+    {
+      return _misses.load(std::memory_order_relaxed);
+    }
+
+    private:
+    using entry_list = std::list<std::pair<std::string, std::string>>;
+
+    void evict();
+
+    private:
+    size_t                _capacity;
+    mutable std::mutex    _mutex;
+    entry_list            _entries;  // the most recently used first
+    std::unordered_map<std::string, entry_list::iterator> _index;
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_RESPONSE_CACHE_HPP */
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  constexpr int    MAX_EVENTS = 64;
+  constexpr int    BACKLOG = 128;
+  // Stop reading a session while this much output is waiting for the client
+  constexpr size_t MAX_PENDING_OUTPUT = 1 << 20;
+  // Stop accepting clients for this long when the process runs out of descriptors or memory
+  constexpr auto   ACCEPT_BACKOFF = std::chrono::milliseconds(100);
+
+  [[noreturn]] void throw_system_error(const char* what)
+  {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+}
+
+
+Session::Session(int fd)
+  : _fd(fd), _reader(fd), _written(0), _sink(_output), _stream(&_sink), _closing(false),
+    _protocol(Protocol::TEXT)
+{
+}
+
+
+Session::~Session() noexcept
+{
+  ::close(_fd);
+}
+
+
+bool Session::flush()
+{
+  while(_written < _output.size()) {
+    auto size = ::send(_fd, _output.data() + _written, _output.size() - _written, MSG_NOSIGNAL);
+    if(size < 0) {
+      if(errno == EINTR) continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    _written += static_cast<size_t>(size);
+  }
+  _output.clear();
+  _written = 0;
+  return true;
+}
+
+
+//--------------------------------------------------------
+Server::Server(std::string path)
+  : _path(std::move(path)), _listen_fd(-1), _epoll_fd(-1), _event_fd(-1), _accepting(true)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if(_path.size() >= sizeof(address.sun_path)) {
+    throw std::system_error(ENAMETOOLONG, std::generic_category(), _path);
+  }
+  std::strcpy(address.sun_path, _path.c_str());
+
+  // Replace a socket file left by a previous server
+  struct stat status;
+  if(::stat(_path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+    ::unlink(_path.c_str());
+  }
+
+  try {
+    _listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(_listen_fd < 0) throw_system_error("socket");
+    if(::bind(_listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) throw_system_error("bind");
+    if(::listen(_listen_fd, BACKLOG) < 0) throw_system_error("listen");
+
+    _epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if(_epoll_fd < 0) throw_system_error("epoll_create1");
+    _event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(_event_fd < 0) throw_system_error("eventfd");
+
+    for(auto fd : { _listen_fd, _event_fd }) {
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.fd = fd;
+      if(::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) throw_system_error("epoll_ctl");
+    }
+  } catch(...) {
+    release();
+    throw;
+  }
+}
+
+
+Server::~Server() noexcept
+{
+  release();
+}
+
+
+void Server::run(const handler_type& on_open, const handler_type& on_input, const error_handler_type& on_error)
+{
+  using clock_type = std::chrono::steady_clock;
+
+  epoll_event events[MAX_EVENTS];
+  for(;;) {
+    auto timeout = -1;
+    if(!_accepting) {
+      auto rest = std::chrono::duration_cast<std::chrono::milliseconds>(_resume_time - clock_type::now()).count();
+      timeout = static_cast<int>(std::max<decltype(rest)>(rest, 0));
+    }
+    auto num_events = ::epoll_wait(_epoll_fd, events, MAX_EVENTS, timeout);
+    if(num_events < 0) {
+      if(errno == EINTR) continue;
+      throw_system_error("epoll_wait");
+    }
+    if(!_accepting && clock_type::now() >= _resume_time) resume_accepting();
+
+    for(auto i = 0; i < num_events; ++i) {
+      auto fd = events[i].data.fd;
+      if(fd == _event_fd) {
+        uint64_t count;
+        while(::read(_event_fd, &count, sizeof(count)) > 0);
+        return;
+      }
+      if(fd == _listen_fd) {
+        if(_accepting) accept_sessions(on_open, on_error);
+        continue;
+      }
+
+      auto ite = _sessions.find(fd);
+      if(ite == _sessions.end()) continue;
+      auto& session = *ite->second;
+      if(!session.closing() && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        // A single read per event keeps sessions fair; epoll reports the rest again
+        try {
+          session.reader().fill();
+        } catch(const std::system_error&) {
+          ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+          _sessions.erase(ite);
+          resume_accepting();
+          continue;
+        }
+        on_input(session);
+        if(session.reader().eof()) session.close();
+      }
+      update(session);
+    }
+  }
+}
+
+
+void Server::stop() noexcept
+{
+  uint64_t count = 1;
+  auto result = ::write(_event_fd, &count, sizeof(count));
+  (void)result;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+void Server::release() noexcept
+{
+  _sessions.clear();
+  for(auto fd : { _event_fd, _epoll_fd }) {
+    if(fd >= 0) ::close(fd);
+  }
+  if(_listen_fd >= 0) {
+    ::close(_listen_fd);
+    ::unlink(_path.c_str());
+  }
+  _listen_fd = _epoll_fd = _event_fd = -1;
+}
+
+
+void Server::accept_sessions(const handler_type& on_open, const error_handler_type& on_error)
+{
+  for(;;) {
+    auto fd = ::accept4(_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd < 0) {
+      if(errno == EINTR) continue;
+      if(errno == EAGAIN || errno == EWOULDBLOCK) return;
+      if(errno == ECONNABORTED) continue;
+      if(errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+        // The pending client stays in the backlog, so keep serving the others for a while
+        const std::system_error error(errno, std::generic_category(), "accept4");
+        pause_accepting();
+        if(on_error) on_error(error);
+        return;
+      }
+      throw_system_error("accept4");
+    }
+
+    std::unique_ptr<Session> session(new Session(fd));
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if(::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) continue;
+
+    auto& target = *session;
+    _sessions.emplace(fd, std::move(session));
+    on_open(target);
+    update(target);
+  }
+}
+
+
+void Server::pause_accepting()
+{
+  // The listen socket is level triggered; it would report the pending client forever
+  epoll_event event{};
+  event.data.fd = _listen_fd;
+  ::epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, _listen_fd, &event);
+  _accepting = false;
+  _resume_time = std::chrono::steady_clock::now() + ACCEPT_BACKOFF;
+}
+
+
+void Server::resume_accepting()
+{
+  if(_accepting) return;
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = _listen_fd;
+  ::epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, _listen_fd, &event);
+  _accepting = true;
+}
+
+
+void Server::update(Session& session)
+{
+  auto fd = session.fd();
+  if(!session.flush() || (session.closing() && session.pending() == 0)) {
+    ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    _sessions.erase(fd);
+    resume_accepting();
+    return;
+  }
+
+  epoll_event event{};
+  event.data.fd = fd;
+  if(!session.closing() && session.pending() < MAX_PENDING_OUTPUT) event.events |= EPOLLIN;
+  if(session.pending() > 0) event.events |= EPOLLOUT;
+  ::epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+}
@@ -0,0 +1,205 @@
+/*!
+ * @file  server.hpp
+ * @brief Unix domain socket server multiplexing sessions with epoll
+ */
+#ifndef CLI_BASIC_ENGINE_SERVER_HPP
+#define CLI_BASIC_ENGINE_SERVER_HPP
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <boost/noncopyable.hpp>
+
+#include "line_reader.hpp"
+#include "protocol.hpp"
+
+
+namespace cli {
+
+  /*!
+   * @brief  Connection state of a client
+   * @note   Input is buffered in the reader until complete lines arrive,
+   *         and output is buffered until the socket accepts it.
+   */
+  class Session : private boost::noncopyable {
+
+    public:
+    /*!
+     * @brief      Ctor.
+     * @param[in]  fd : connected non-blocking socket (owned)
+     */
+    explicit Session(int fd);
+
+    //! dtor. closes the socket
+    ~Session() noexcept;
+
+    //! Returns the socket
+    int fd() const noexcept
+    {
+      return _fd;
+    }
+
+    //! Returns reader of the buffered input
+    LineReader& reader() noexcept
+    {
+      return _reader;
+    }
+
+    //! Returns stream to buffer output
+    std::ostream& output() noexcept
+    {
+      return _stream;
+    }
+
+    //! Returns the size of output not written yet
+    size_t pending() const noexcept
+    {
+      return _output.size() - _written;
+    }
+
+    /*!
+     * @brief   Write buffered output as much as the socket accepts
+     * @retval  false : the connection is broken
+     */
+    bool flush();
+
+    //! Close the session after the buffered output is written
+    void close() noexcept
+    {
+      _closing = true;
+    }
+
+    //! Check the session is closing
+    bool closing() const noexcept
+    {
+      return _closing;
+    }
+
+    //! Returns the framing negotiated in the session
+    Protocol protocol() const noexcept
+    {
+      return _protocol;
+    }
+
+    //! Switch the framing of the session
+    void set_protocol(Protocol protocol) noexcept
+    {
+      _protocol = protocol;
+    }
+
+
+    private:
+    //! Stream buffer appending to the output string
+    class Sink : public std::streambuf {
+      public:
+      explicit Sink(std::string& output) noexcept : _output(output) {}
+
+      protected:
+      int_type overflow(int_type c) override
+      {
+        if(!traits_type::eq_int_type(c, traits_type::eof())) _output.push_back(traits_type::to_char_type(c));
+        return traits_type::not_eof(c);
+      }
+
+      std::streamsize xsputn(const char* s, std::streamsize n) override
+      {
+        _output.append(s, static_cast<size_t>(n));
+        return n;
+      }
+
+      private:
+      std::string& _output;
+    };
+
+    private:
+    int          _fd;
+    LineReader   _reader;
+    std::string  _output;
+    size_t       _written;
+    Sink         _sink;
+    std::ostream _stream;
+    bool         _closing;
+    Protocol     _protocol;
+
+  };
+
+
+  /*!
+   * @brief  Server accepting clients on a Unix domain socket
+   * @code
+   * // Usage
+   * Server server( "/tmp/engine.sock" );
+   * server.run( [](Session& s){ s.output() << "hello\n"; },
+   *             [](Session& s){
+   *               LineReader::line_type line;
+   *               while( s.reader().next_buffered(line) ) s.output() << line << '\n';
+   *               if( s.reader().eof() ) s.close();
+   *             } );
+   * @endcode
+   */
+  class Server : private boost::noncopyable {
+
+    public:
+    /*!
+     * @typedef  handler_type
+     * @brief    Type of session event handlers
+     */
+    using handler_type = std::function<void(Session&)>;
+
+    /*!
+     * @typedef  error_handler_type
+     * @brief    Type of handlers of errors the server recovers from
+     */
+    using error_handler_type = std::function<void(const std::system_error&)>;
+
+    /*!
+     * @brief      Ctor. binds and listens the socket
+     * @param[in]  path : path of the socket; a stale socket file is replaced
+     * @exception  std::system_error : thrown if the socket cannot be listened
+     */
+    explicit Server(std::string path);
+
+    //! dtor. closes all sessions and removes the socket file
+    ~Server() noexcept;
+
+    /*!
+     * @brief      Serve sessions until stop() is called
+     * @param[in]  on_open  : called when a client is connected
+     * @param[in]  on_input : called when input is read into the session's reader
+     * @param[in]  on_error : called when accepting clients fails for lack of resources;
+     *                        new clients wait until a session closes or a short back-off passes
+     * @exception  std::system_error : thrown if waiting for events fails
+     */
+    void run(const handler_type& on_open, const handler_type& on_input,
+             const error_handler_type& on_error = error_handler_type());
+
+    //! Stop run(); it can be called from other threads and signal handlers
+    void stop() noexcept;
+
+
+    private:
+    void release() noexcept;
+    void accept_sessions(const handler_type& on_open, const error_handler_type& on_error);
+    void pause_accepting();
+    void resume_accepting();
+    void update(Session& session);
+
+    private:
+    std::string _path;
+    int _listen_fd;
+    int _epoll_fd;
+    int _event_fd;
+    bool _accepting;
+    std::chrono::steady_clock::time_point _resume_time;
+    std::unordered_map<int, std::unique_ptr<Session>> _sessions;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_SERVER_HPP */
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "session_record.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  constexpr char MAGIC[8] = { 'C', 'L', 'I', 'S', 'E', 'S', 'S', '1' };
+  constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 8;
+  constexpr size_t RECORD_HEADER_SIZE = 8 + 8 + 4 + 4 + 1;
+
+  // Size of blocks to read and write
+  constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  // Commands longer than this are not session files but corruption
+  constexpr uint32_t MAX_COMMAND_SIZE = 1u << 30;
+
+  [[noreturn]] void throw_system_error(const char* what)
+  {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  template<class T>
+  void put(std::string& buffer, T value)
+  {
+    char bytes[sizeof(T)];
+    for(size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = static_cast<char>(static_cast<uint64_t>(value) >> (8 * i));
+    }
+    buffer.append(bytes, sizeof(T));
+  }
+
+  template<class T>
+  T get(const char* bytes) noexcept
+  {
+    uint64_t value = 0;
+    for(size_t i = 0; i < sizeof(T); ++i) {
+      value |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+    }
+    return static_cast<T>(value);
+  }
+
+  void write_all(int fd, const char* data, size_t size)
+  {
+    while(size > 0) {
+      auto written = ::write(fd, data, size);
+      if(written < 0) {
+        if(errno == EINTR) continue;
+        throw_system_error("write");
+      }
+      data += written, size -= static_cast<size_t>(written);
+    }
+  }
+
+}
+
+
+uint64_t cli::hash_response(boost::string_ref response) noexcept
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for(auto c : response) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+
+//--------------------------------------------------------
+SessionRecorder::SessionRecorder(const std::string& path)
+  : _fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)),
+    _start(clock_type::now())
+{
+  if(_fd < 0) throw std::system_error(errno, std::generic_category(), path);
+  const auto start_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  _buffer.reserve(BLOCK_SIZE + RECORD_HEADER_SIZE);
+  _buffer.append(MAGIC, sizeof(MAGIC));
+  put<int64_t>(_buffer, start_time);
+}
+
+
+SessionRecorder::~SessionRecorder() noexcept
+{
+  try {
+    flush();
+  } catch(const std::system_error&) {
+    // Records which cannot be written are lost
+  }
+  ::close(_fd);
+}
+
+
+void SessionRecorder::record(boost::string_ref command, ResponseStatus status, boost::string_ref response,
+                             clock_type::time_point received)
+{
+  const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(received, _start) - _start).count();
+  put<uint64_t>(_buffer, static_cast<uint64_t>(time));
+  put<uint64_t>(_buffer, hash_response(response));
+  put<uint32_t>(_buffer, static_cast<uint32_t>(response.size()));
+  put<uint32_t>(_buffer, static_cast<uint32_t>(command.size()));
+  put<uint8_t>(_buffer, static_cast<uint8_t>(status));
+  _buffer.append(command.data(), command.size());
+  if(_buffer.size() >= BLOCK_SIZE) flush();
+}
+
+
+void SessionRecorder::flush()
+{
+  write_all(_fd, _buffer.data(), _buffer.size());
+  _buffer.clear();
+}
+
+
+//--------------------------------------------------------
+SessionReader::SessionReader(const std::string& path)
+  : _fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)), _start_time(0), _begin(0)
+{
+  if(_fd < 0) throw std::system_error(errno, std::generic_category(), path);
+  char header[HEADER_SIZE];
+  if(!read(header, sizeof(header)) || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0) {
+    ::close(_fd);
+    throw std::runtime_error(path + " is not a session file");
+  }
+  _start_time = get<int64_t>(header + sizeof(MAGIC));
+}
+
+
+SessionReader::~SessionReader() noexcept
+{
+  ::close(_fd);
+}
+
+
+bool SessionReader::next(SessionRecord& record)
+{
+  char header[RECORD_HEADER_SIZE];
+  if(!read(header, 1)) return false;
+  if(!read(header + 1, sizeof(header) - 1)) throw std::runtime_error("truncated session record");
+
+  record.time          = get<uint64_t>(header);
+  record.response_hash = get<uint64_t>(header + 8);
+  record.response_size = get<uint32_t>(header + 16);
+  const auto command_size = get<uint32_t>(header + 20);
+  const auto status = get<uint8_t>(header + 24);
+  if(status > static_cast<uint8_t>(ResponseStatus::ABORTED) || command_size > MAX_COMMAND_SIZE) {
+    throw std::runtime_error("broken session record");
+  }
+  record.status = static_cast<ResponseStatus>(status);
+  record.command.resize(command_size);
+  if(command_size > 0 && !read(&record.command[0], command_size)) {
+    throw std::runtime_error("truncated session record");
+  }
+  return true;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+bool SessionReader::read(char* data, size_t size)
+{
+  while(size > 0) {
+    if(_begin == _buffer.size()) {
+      _buffer.resize(BLOCK_SIZE);
+      ssize_t n;
+      while((n = ::read(_fd, &_buffer[0], BLOCK_SIZE)) < 0) {
+        if(errno != EINTR) throw_system_error("read");
+      }
+      _buffer.resize(static_cast<size_t>(n));
+      _begin = 0;
+      if(n == 0) return false;
+    }
+    const auto chunk = std::min(size, _buffer.size() - _begin);
+    std::memcpy(data, _buffer.data() + _begin, chunk);
+    _begin += chunk, data += chunk, size -= chunk;
+  }
+  return true;
+}
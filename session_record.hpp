@@ -0,0 +1,128 @@
+/*!
+ * @file  session_record.hpp
+ * @brief Binary record of command sessions for replay
+ */
+#ifndef CLI_BASIC_ENGINE_SESSION_RECORD_HPP
+#define CLI_BASIC_ENGINE_SESSION_RECORD_HPP
+
+#include <chrono>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "protocol.hpp"
+
+
+namespace cli {
+
+  //! Recorded command
+  struct SessionRecord {
+    uint64_t      time;           //!< time the command was read in ns since the recording started
+    ResponseStatus status;
+    uint32_t      response_size;
+    uint64_t      response_hash;  //!< hash_response() of the response
+    std::string   command;
+  };
+
+  //! Returns the hash of a response to verify replayed responses (FNV-1a)
+  uint64_t hash_response(boost::string_ref response) noexcept;
+
+
+  /*!
+   * @brief  Writer of session files
+   * @note   The file starts with an 8-byte magic "CLISESS1" and the wall clock time of the
+   *         start in ns. Each record is laid out in little endian as follows, and
+   *         the records are buffered and written in blocks.
+   * @code
+   * u64 time | u64 response_hash | u32 response_size | u32 command_size | u8 status | command
+   * @endcode
+   */
+  class SessionRecorder : private boost::noncopyable {
+
+    public:
+    using clock_type = std::chrono::steady_clock;
+
+    /*!
+     * @brief      Ctor. creates the file
+     * @param[in]  path : path of the session file; an existent file is truncated
+     * @exception  std::system_error : thrown if the file cannot be created
+     */
+    explicit SessionRecorder(const std::string& path);
+
+    //! dtor. writes buffered records
+    ~SessionRecorder() noexcept;
+
+    /*!
+     * @brief      Record a command and its response
+     * @param[in]  received : time the command was read [default = now]
+     * @exception  std::system_error : thrown if writing the file fails
+     */
+    void record(boost::string_ref command, ResponseStatus status, boost::string_ref response,
+                clock_type::time_point received = clock_type::now());
+
+    /*!
+     * @brief      Write buffered records
+     * @exception  std::system_error : thrown if writing the file fails
+     */
+    void flush();
+
+    private:
+    int               _fd;
+    clock_type::time_point _start;
+    std::string       _buffer;
+
+  };
+
+
+  /*!
+   * @brief  Reader of session files
+   * @code
+   * // Usage
+   * SessionReader reader( "session.bin" );
+   * SessionRecord record;
+   * while( reader.next(record) ) replay( record.command );
+   * @endcode
+   */
+  class SessionReader : private boost::noncopyable {
+
+    public:
+    /*!
+     * @brief      Ctor. opens the file and reads its header
+     * @exception  std::system_error  : thrown if the file cannot be read
+     * @exception  std::runtime_error : thrown if the file is not a session file
+     */
+    explicit SessionReader(const std::string& path);
+
+    //! dtor.
+    ~SessionReader() noexcept;
+
+    /*!
+     * @brief       Read the next record
+     * @retval      false : no more record
+     * @exception   std::runtime_error : thrown if the record is truncated
+     */
+    bool next(SessionRecord& record);
+
+    //! Returns the wall clock time when the recording started, in ns since the epoch
+    int64_t start_time() const noexcept
+    {
+      return _start_time;
+    }
+
+    private:
+    bool read(char* data, size_t size);
+
+    private:
+    int         _fd;
+    int64_t     _start_time;
+    std::string _buffer;
+    size_t      _begin;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_SESSION_RECORD_HPP */
@@ -0,0 +1,115 @@
+/*!
+ * @file  spsc_ring.hpp
+ * @brief Bounded lock-free single-producer single-consumer ring buffer
+ */
+#ifndef CLI_BASIC_ENGINE_SPSC_RING_HPP
+#define CLI_BASIC_ENGINE_SPSC_RING_HPP
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <boost/noncopyable.hpp>
+
+#include <cassert>
+#include <cstddef>
+
+
+namespace cli {
+
+  /*!
+   * @brief   Bounded ring connecting a producer thread and a consumer thread
+   * @tparam  T : type of elements (default constructible and movable)
+   * @note    Both push and pop fail instead of blocking. Each side caches the index
+   *          of the other side, so the shared indices are read only when the ring
+   *          looks full or empty.
+   * @code
+   * // Usage
+   * SpscRing<size_t> ring( 1024 );  // capacity must be a power of 2
+   * ring.try_push( 42 );            // on the producer thread
+   *
+   * size_t value;
+   * if( ring.try_pop(value) ) use( value );  // on the consumer thread
+   * @endcode
+   */
+  template<class T>
+  class SpscRing : private boost::noncopyable {
+
+    public:
+    /*!
+     * @brief      Ctor.
+     * @param[in]  capacity : the number of slots, a power of 2
+     */
+    explicit SpscRing(size_t capacity)
+      : _slots(new T[capacity]), _mask(capacity - 1),
+        _head(0), _cached_tail(0), _tail(0), _cached_head(0)
+    {
+      assert(capacity >= 2 && (capacity & _mask) == 0);
+    }
+
+    //! Returns the number of slots
+    size_t capacity() const noexcept
+    {
+      return _mask + 1;
+    }
+
+    /*!
+     * @brief      Push an element if there is a free slot; call it on the producer thread
+     * @retval     false : the ring is full, and the value is not moved
+     */
+    bool try_push(T&& value)
+    {
+      const auto tail = _tail.load(std::memory_order_relaxed);
+      if(tail - _cached_head > _mask) {
+        _cached_head = _head.load(std::memory_order_acquire);
+        if(tail - _cached_head > _mask) return false;
+      }
+      _slots[tail & _mask] = std::move(value);
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /*!
+     * @brief      Pop the oldest element if any; call it on the consumer thread
+     * @retval     false : the ring is empty
+     */
+    bool try_pop(T& value)
+    {
+      const auto head = _head.load(std::memory_order_relaxed);
+      if(head == _cached_tail) {
+        _cached_tail = _tail.load(std::memory_order_acquire);
+        if(head == _cached_tail) return false;
+      }
+      value = std::move(_slots[head & _mask]);
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    //! Check the ring is empty; it is exact only on the consumer thread
+    bool empty() const noexcept
+    {
+      return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire);
+    }
+
+
+    private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    private:
+    std::unique_ptr<T[]> _slots;
+    const size_t         _mask;
+    // Each side's fields are padded to a cache line of their own, as in BoundedQueue
+    char                 _padding_head[CACHE_LINE];
+    // Written by the consumer
+    std::atomic<size_t>  _head;
+    size_t               _cached_tail;
+    char                 _padding_tail[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    // Written by the producer
+    std::atomic<size_t>  _tail;
+    size_t               _cached_head;
+    char                 _padding_end[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_SPSC_RING_HPP */
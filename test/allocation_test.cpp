@@ -0,0 +1,57 @@
+/*
+ * Checks of heap allocations, built as an executable of its own because it
+ * replaces the global operator new of the process.
+ */
+#define BOOST_TEST_MODULE allocation_test
+#include <boost/test/included/unit_test.hpp>
+#include <new>
+
+#include <cstdlib>
+
+#include "../command.hpp"
+
+
+namespace {
+
+  size_t num_allocations = 0;
+
+}
+
+// Count heap allocations of the test process
+void* operator new(size_t size)
+{
+  ++num_allocations;
+  if(auto p = std::malloc(size > 0 ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+
+using namespace cli;
+
+
+BOOST_AUTO_TEST_SUITE( allocation_test )
+
+  BOOST_AUTO_TEST_CASE(test_parse_without_allocation)
+  {
+    Command command;
+    command.parse("warm up the command buffer with a long line of 9 arguments");
+    const auto before = num_allocations;
+    for( auto i = 0; i < 100; ++i ) {
+      command.parse("this is a test");
+      command.parse("set  the value of a long option name to 12345");
+    }
+    BOOST_CHECK_EQUAL( num_allocations - before, 0 );
+    BOOST_CHECK_EQUAL( command.argument(8), "12345" );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+
+#include "../arena.hpp"
+
+
+using namespace cli;
+
+BOOST_AUTO_TEST_SUITE( arena_test )
+
+  BOOST_AUTO_TEST_CASE( test_allocate )
+  {
+    Arena arena(64);
+    BOOST_CHECK_EQUAL( arena.num_blocks(), 0 );
+
+    auto byte = arena.allocate<char>(1);
+    auto value = arena.allocate<double>(2);
+    BOOST_CHECK( byte != nullptr );
+    BOOST_CHECK_EQUAL( reinterpret_cast<uintptr_t>(value) % alignof(double), 0 );
+    BOOST_CHECK_EQUAL( reinterpret_cast<uintptr_t>(arena.allocate(1, 32)) % 32, 0 );
+    BOOST_CHECK_EQUAL( arena.num_blocks(), 1 );
+
+    // Larger than a block
+    auto large = arena.allocate<char>(1000);
+    std::fill(large, large + 1000, 'x');
+    BOOST_CHECK_EQUAL( arena.num_blocks(), 2 );
+    BOOST_CHECK_EQUAL( arena.capacity(), 64 + 1000 );
+
+    auto copied = arena.copy("scratch");
+    BOOST_CHECK_EQUAL( copied, "scratch" );
+    BOOST_CHECK_EQUAL( arena.num_blocks(), 3 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_reset )
+  {
+    Arena arena(64);
+    std::vector<void*> first;
+    for(auto size : { 16, 40, 1000, 8 }) first.push_back(arena.allocate(size));
+    const auto capacity = arena.capacity();
+
+    // The same allocations reuse the blocks
+    arena.reset();
+    std::vector<void*> second;
+    for(auto size : { 16, 40, 1000, 8 }) second.push_back(arena.allocate(size));
+    BOOST_CHECK( first == second );
+    BOOST_CHECK_EQUAL( arena.capacity(), capacity );
+
+    // Kept blocks too small for a request are skipped
+    arena.reset();
+    BOOST_CHECK_EQUAL( arena.allocate(500), first[2] );
+    BOOST_CHECK_EQUAL( arena.capacity(), capacity );
+
+    Arena moved(std::move(arena));
+    BOOST_CHECK_EQUAL( moved.capacity(), capacity );
+    BOOST_CHECK_EQUAL( arena.capacity(), 0 );
+    moved.reset();
+    BOOST_CHECK_EQUAL( moved.allocate(16), first[0] );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_allocator )
+  {
+    Arena arena;
+    std::vector<int, ArenaAllocator<int>> values{ ArenaAllocator<int>(arena) };
+    for(auto i = 0; i < 100; ++i) values.push_back(i);
+    BOOST_CHECK_EQUAL( values[99], 99 );
+    BOOST_CHECK_EQUAL( arena.num_blocks(), 1 );
+
+    using string_type = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+    string_type string{ ArenaAllocator<char>(arena) };
+    string.append(100, 'x');
+    BOOST_CHECK_EQUAL( string.size(), 100 );
+    BOOST_CHECK( ArenaAllocator<char>(arena) == values.get_allocator() );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+#include "../argument_schema.hpp"
+#include "../command.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  template<class T>
+  from_chars_result parse(const char* str, T& value)
+  {
+    return from_chars(str, str + std::strlen(str), value);
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( argument_schema_test )
+
+  BOOST_AUTO_TEST_CASE( test_integer_from_chars )
+  {
+    long long value = 0;
+    BOOST_CHECK( parse("12345", value).ec == std::errc() );
+    BOOST_CHECK_EQUAL( value, 12345 );
+    BOOST_CHECK( parse("-9223372036854775808", value).ec == std::errc() );
+    BOOST_CHECK_EQUAL( value, std::numeric_limits<long long>::min() );
+    BOOST_CHECK( parse("9223372036854775807", value).ec == std::errc() );
+    BOOST_CHECK_EQUAL( value, std::numeric_limits<long long>::max() );
+
+    BOOST_CHECK( parse("9223372036854775808", value).ec == std::errc::result_out_of_range );
+    BOOST_CHECK( parse("+1", value).ec == std::errc::invalid_argument );
+    BOOST_CHECK( parse("-", value).ec == std::errc::invalid_argument );
+    const char* str = "42abc";
+    auto result = parse(str, value);
+    BOOST_CHECK( result.ec == std::errc() );
+    BOOST_CHECK_EQUAL( result.ptr - str, 2 );
+    BOOST_CHECK_EQUAL( value, 42 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_real_from_chars )
+  {
+    for(auto str : { "0", "-0.5", "3.14159", "1e10", "2.5E-3", "123456789012345678901234", "1e-300",
+                     "0.000000000000000000000001", "5.", "17976931348623157e292" }) {
+      double value = 0.0;
+      auto result = parse(str, value);
+      BOOST_CHECK( result.ec == std::errc() );
+      BOOST_CHECK_EQUAL( result.ptr, str + std::strlen(str) );
+      BOOST_CHECK_EQUAL( value, std::strtod(str, nullptr) );
+    }
+    double value = 0.0;
+    // Longer than the stack buffer of the fallback to strtod()
+    for(auto str : { "0." + std::string(200, '0') + "15", "3." + std::string(300, '3'),
+                     std::string(200, '1') + "e-100" }) {
+      auto result = parse(str.c_str(), value);
+      BOOST_CHECK( result.ec == std::errc() );
+      BOOST_CHECK_EQUAL( value, std::strtod(str.c_str(), nullptr) );
+    }
+    BOOST_CHECK( parse("1e400", value).ec == std::errc::result_out_of_range );
+    BOOST_CHECK( parse("1e-400", value).ec == std::errc::result_out_of_range );
+    BOOST_CHECK( parse("-1e-400", value).ec == std::errc::result_out_of_range );
+    BOOST_CHECK( parse("0e-400", value).ec == std::errc() );
+    BOOST_CHECK( parse(".", value).ec == std::errc::invalid_argument );
+    BOOST_CHECK( parse("abc", value).ec == std::errc::invalid_argument );
+    const char* str = "1.5e";
+    BOOST_CHECK_EQUAL( parse(str, value).ptr, str + 3 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_validate )
+  {
+    auto schema = ArgumentSchema().string("name")
+                                  .integer("count", 1, 100)
+                                  .real("ratio", 0.0, 1.0).optional();
+    Command command("set key 10 0.25");
+    BOOST_REQUIRE( schema.validate(command) );
+    BOOST_CHECK_EQUAL( command.integer_argument(1), 10 );
+    BOOST_CHECK_EQUAL( command.real_argument(2), 0.25 );
+
+    command.parse("set key 10");
+    BOOST_CHECK( schema.validate(command) );
+
+    command.parse("set key");
+    BOOST_CHECK( !schema.validate(command) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'set' requires 2 arguments at least" );
+
+    command.parse("set key 1 0.5 extra");
+    BOOST_CHECK( !schema.validate(command) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'set' requires 3 arguments at most" );
+
+    command.parse("set key ten");
+    BOOST_CHECK( !schema.validate(command) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'set' requires an integer for 'count': ten" );
+
+    command.parse("set key 101");
+    BOOST_CHECK( !schema.validate(command) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'set' requires an integer in [1, 100] for 'count': 101" );
+
+    command.parse("set key 1 1.5");
+    BOOST_CHECK( !schema.validate(command) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'set' requires a real number in [0, 1] for 'ratio': 1.5" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_validate_variadic )
+  {
+    auto schema = ArgumentSchema().integer("values").variadic();
+    Command command("sum");
+    BOOST_CHECK( !schema.validate(command) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'sum' requires 1 argument at least" );
+
+    command.parse("sum 1 2 3 4 5 6 7 8 9 10 -11");
+    BOOST_REQUIRE( schema.validate(command) );
+    long long sum = 0;
+    for(size_t i = 0; i < command.num_arguments(); ++i) sum += command.integer_argument(i);
+    BOOST_CHECK_EQUAL( sum, 44 );
+
+    command.parse("sum 1 2 x");
+    BOOST_CHECK( !schema.validate(command) );
+
+    auto exact = ArgumentSchema().string("key");
+    command.parse("get");
+    BOOST_CHECK( !exact.validate(command) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'get' requires 1 argument" );
+    BOOST_CHECK_THROW( ArgumentSchema().string("a").variadic().string("b"), std::logic_error );
+    BOOST_CHECK_THROW( ArgumentSchema().optional(), std::logic_error );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
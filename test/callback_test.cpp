@@ -1,3 +1,5 @@
+#include <memory>
+#include <string>
 #include <boost/test/unit_test.hpp>
 
 #include "../command.hpp"
@@ -53,4 +55,50 @@ BOOST_AUTO_TEST_SUITE( callback_test )
     BOOST_CHECK_EQUAL( command.response(), "called TestEngine#test for instance id: 1" );
   }
 
+  BOOST_AUTO_TEST_CASE(test_type_erased_callback)
+  {
+    TestEngine engine(2);
+    Callback callback_static( &test_command );
+    Callback callback_member = make_callback( &engine, &TestEngine::test );
+    const char* suffix = "!";
+    Callback callback_lambda( [&engine, suffix](Command& command){
+      engine.test( command );
+      command.response_stream() << suffix;
+    } );
+    Callback callback_legacy( std::unique_ptr<CallbackFunction>(new CallbackStaticFunction(&test_command)) );
+
+    Command command;
+    callback_static( command );
+    BOOST_CHECK_EQUAL( command.response(), "called test_command(Command&)" );
+    command.clear();
+    callback_member( command );
+    BOOST_CHECK_EQUAL( command.response(), "called TestEngine#test for instance id: 2" );
+    command.clear();
+    callback_lambda( command );
+    BOOST_CHECK_EQUAL( command.response(), "called TestEngine#test for instance id: 2!" );
+    command.clear();
+    callback_legacy( command );
+    BOOST_CHECK_EQUAL( command.response(), "called test_command(Command&)" );
+  }
+
+  BOOST_AUTO_TEST_CASE(test_move_callback)
+  {
+    auto counter = std::make_shared<int>(0);
+    Callback callback( [counter](Command&){ ++*counter; } );
+    BOOST_CHECK_EQUAL( counter.use_count(), 2 );
+
+    Callback moved( std::move(callback) );
+    BOOST_CHECK( !callback );
+    BOOST_REQUIRE( moved );
+    Command command;
+    moved( command );
+    BOOST_CHECK_EQUAL( *counter, 1 );
+    BOOST_CHECK_EQUAL( counter.use_count(), 2 );
+
+    moved = Callback( &test_command );
+    BOOST_CHECK_EQUAL( counter.use_count(), 1 );
+    moved( command );
+    BOOST_CHECK_EQUAL( command.response(), "called test_command(Command&)" );
+  }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,7 +1,13 @@
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <cstring>
 
 #include "../command.hpp"
+#include "../failure.hpp"
 
 
 using namespace cli;
@@ -47,6 +53,72 @@ BOOST_AUTO_TEST_SUITE( command_test )
     BOOST_CHECK_EQUAL( command.argument(3), "test" );
   }
 
+  BOOST_AUTO_TEST_CASE(test_many_arguments)
+  {
+    Command command("  sum 1 2 3 4 5 6 7 8 9   10 ");
+    BOOST_CHECK_EQUAL( command.name(), "sum" );
+    BOOST_REQUIRE_EQUAL( command.num_arguments(), 10 );
+    for( size_t i = 0; i < command.num_arguments(); ++i ) {
+      BOOST_CHECK_EQUAL( command.argument(i), std::to_string(i + 1) );
+    }
+    Command moved( std::move(command) );
+    BOOST_CHECK_EQUAL( moved.argument(9), "10" );
+  }
+
+  BOOST_AUTO_TEST_CASE(test_string_arguments)
+  {
+    // Callbacks written for std::string arguments
+    Command command("Set key 42");
+    std::string key = command.argument(0);
+    const std::string& name = command.name();
+    std::string copied;
+    copied = command.argument(0);
+    BOOST_CHECK_EQUAL( key, "key" );
+    BOOST_CHECK_EQUAL( name, "Set" );
+    BOOST_CHECK_EQUAL( copied, "key" );
+    BOOST_CHECK_EQUAL( std::stoi(command.argument(1)), 42 );
+    BOOST_CHECK( command.name() == "Set" );
+    command.response_stream() << command.argument(0) << '=' << command.argument(1);
+    BOOST_CHECK_EQUAL( command.response(), "key=42" );
+  }
+
+  BOOST_AUTO_TEST_CASE(test_legacy_arguments)
+  {
+    // Call sites written when arguments were stored as std::string
+    Command command("get key");
+    BOOST_CHECK_EQUAL( std::strcmp(command.argument(0).c_str(), "key"), 0 );
+    BOOST_CHECK_EQUAL( "no such key: " + command.argument(0), "no such key: key" );
+    BOOST_CHECK_EQUAL( command.name() + " " + command.argument(0), "get key" );
+    const Command::argument_type& name = command.name();
+    Command::container_type arguments{ command.argument(0) };
+    BOOST_CHECK_EQUAL( name, "get" );
+    BOOST_CHECK_EQUAL( arguments.front(), "key" );
+
+    // Re-parsing replaces the copies
+    command.parse("set other 42");
+    BOOST_CHECK_EQUAL( command.name(), "set" );
+    BOOST_CHECK_EQUAL( command.argument(1), "42" );
+    BOOST_CHECK_EQUAL( command.argument_view(0), "other" );
+    BOOST_CHECK( command.name_view().data() == command.raw_string().data() );
+  }
+
+  BOOST_AUTO_TEST_CASE(test_assign_tokens)
+  {
+    Command command("previous command");
+    command.response_stream() << "previous response";
+    const std::vector<std::string> numbers{ "0", "1", "2", "3", "4", "5", "6", "7" };
+    std::vector<boost::string_ref> tokens{ "set", "key", "hello  world", "" };
+    tokens.insert(tokens.end(), numbers.begin(), numbers.end());
+    command.assign(tokens.data(), tokens.size());
+    BOOST_CHECK_EQUAL( command.name(), "set" );
+    BOOST_REQUIRE_EQUAL( command.num_arguments(), tokens.size() - 1 );
+    for(size_t i = 1; i < tokens.size(); ++i) {
+      BOOST_CHECK_EQUAL( command.argument(i - 1), tokens[i] );
+    }
+    BOOST_CHECK_EQUAL( command.raw_string(), "set key hello  world  0 1 2 3 4 5 6 7" );
+    BOOST_CHECK_EQUAL( command.response(), "" );
+  }
+
   BOOST_AUTO_TEST_CASE(test_response)
   {
     Command command("This is a test command");
@@ -66,4 +138,38 @@ BOOST_AUTO_TEST_SUITE( command_test )
     BOOST_CHECK_EQUAL( command.response(), "" );
   }
 
+  BOOST_AUTO_TEST_CASE(test_check_num_arguments)
+  {
+    Command command("set key value");
+    check_num_arguments_equal(command, 2);
+    BOOST_CHECK( check_num_arguments_at_least(command, 1, std::nothrow) );
+    BOOST_CHECK( !command.failed() );
+
+    try {
+      check_num_arguments_at_most(command, 1, "key only");
+      BOOST_ERROR( "Failure is not thrown" );
+    } catch( const Failure& f ) {
+      BOOST_CHECK_EQUAL( f.what(), "Command 'set' requires 1 argument at most: key only" );
+    }
+    BOOST_CHECK_THROW( check_num_arguments_equal(command, 0), Failure );
+  }
+
+  BOOST_AUTO_TEST_CASE(test_fail_without_exception)
+  {
+    Command command("set key value");
+    command.response_stream() << "partial response";
+    BOOST_CHECK( !check_num_arguments_at_most(command, 1, std::nothrow, "key only") );
+    BOOST_CHECK( command.failed() );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'set' requires 1 argument at most: key only" );
+
+    BOOST_CHECK( !check_num_arguments_at_least(command, 3, std::nothrow) );
+    BOOST_CHECK_EQUAL( command.response(), "Command 'set' requires 3 arguments at least" );
+
+    command.parse("get key");
+    BOOST_CHECK( !command.failed() );
+    command.fail() << "no such key: " << command.argument(0);
+    BOOST_CHECK( command.failed() );
+    BOOST_CHECK_EQUAL( command.response(), "no such key: key" );
+  }
+
 BOOST_AUTO_TEST_SUITE_END()
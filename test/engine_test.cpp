@@ -0,0 +1,709 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+#include "../engine.hpp"
+#include "../command.hpp"
+#include "../callback.hpp"
+#include "../failure.hpp"
+#include "../protocol.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  class TestEngine : public Engine {
+    public:
+    TestEngine()
+    {
+      register_callback("square",
+                        std::unique_ptr<CallbackFunction>(new CallbackMemberFunction<TestEngine>(this, &TestEngine::square)),
+                        "Square of the argument",
+                        CallbackAttribute::CONCURRENT);
+    }
+
+    void square(Command& command)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      auto value = std::stoi(command.argument(0));
+      command.response_stream() << value * value;
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(std::this_thread::get_id());
+    }
+
+    std::mutex                 mutex;
+    std::set<std::thread::id>  threads;
+  };
+
+  class RegisteringEngine : public TestEngine {
+    public:
+    void cube(Command& command)
+    {
+      auto value = std::stoi(command.argument(0));
+      command.response_stream() << value * value * value;
+    }
+
+    using Engine::register_callback;
+    using Engine::remove_callback;
+    using Engine::is_registered;
+  };
+
+  class FailingEngine : public Engine {
+    public:
+    FailingEngine()
+    {
+      register_callback("throw", [](Command& command){
+        command.response_stream() << "partial";
+        throw Failure() << "thrown: " << command.num_arguments();
+      });
+      register_callback("fail", [](Command& command){
+        command.response_stream() << "partial";
+        command.fail() << "failed: " << command.num_arguments();
+      });
+      register_callback("add", [](Command& command){
+        command.response_stream() << command.integer_argument(0) + command.integer_argument(1);
+      }, ArgumentSchema().integer("lhs").integer("rhs", 0, 9), "Sum of the arguments");
+    }
+  };
+
+  class CachingEngine : public Engine {
+    public:
+    CachingEngine()
+    {
+      register_callback("get", [this](Command& command){
+        ++calls;
+        command.response_stream() << command.argument(0) << '=' << value;
+      }, ArgumentSchema().string("key"), "Cached value", CallbackAttribute::CACHEABLE);
+      register_callback("set", [this](Command& command){
+        value = command.argument(0);
+        invalidate_cache("get");
+      });
+    }
+
+    using Engine::register_callback;
+    using Engine::response_cache;
+
+    std::string value = "0";
+    size_t      calls = 0;
+  };
+
+  class ScratchEngine : public Engine {
+    public:
+    ScratchEngine()
+    {
+      register_callback("reverse", [this](Command& command){
+        auto& scratch = command.scratch();
+        std::vector<boost::string_ref, ArenaAllocator<boost::string_ref>> words{ ArenaAllocator<boost::string_ref>(scratch) };
+        for(size_t i = command.num_arguments(); i > 0; --i) words.push_back(scratch.copy(command.argument(i - 1)));
+        scratch.allocate(SCRATCH_SIZE);
+        for(auto word : words) command.response_stream() << word << ' ';
+        auto capacity = max_capacity.load();
+        while(capacity < scratch.capacity() && !max_capacity.compare_exchange_weak(capacity, scratch.capacity()));
+      }, "Arguments in reverse order", CallbackAttribute::CONCURRENT);
+    }
+
+    static constexpr size_t SCRATCH_SIZE = 1000;
+    std::atomic<size_t> max_capacity{0};
+  };
+
+  class JobEngine : public Engine {
+    public:
+    JobEngine()
+    {
+      register_job("count", [](Command& command) -> Job {
+        const auto total = command.integer_argument(0);
+        if(total == 0) {
+          command.response_stream() << "nothing to count";
+          return Job();
+        }
+        long long done = 0;
+        return [=](JobContext& context) mutable {
+          context.progress() << ++done << '/' << total;
+          if(done < total) return false;
+          context.command().response_stream() << "counted " << total;
+          return true;
+        };
+      }, ArgumentSchema().integer("total", 0, 1000), "Count up to the total");
+      register_job("explode", [](Command&) -> Job {
+        return [](JobContext& context) {
+          context.progress() << "igniting";
+          context.progress() << "burning";
+          throw Failure() << "exploded";
+          return true;
+        };
+      });
+    }
+  };
+
+  //! Remove progress lines of jobs, which start after a new line or EOT
+  std::string without_progress(const std::string& output)
+  {
+    std::string removed;
+    for(size_t i = 0; i < output.size(); ++i) {
+      const bool head = removed.empty() || removed.back() == '\n' || removed.back() == Engine::EOT;
+      if(head && output[i] == '~') {
+        i = output.find('\n', i);
+        if(i == std::string::npos) break;
+        continue;
+      }
+      removed.push_back(output[i]);
+    }
+    return removed;
+  }
+
+  template<class E = Engine>
+  std::string run(std::initializer_list<const char*> options, const std::string& input, E&& engine = E())
+  {
+    std::vector<const char*> argv{ "engine_test", "--disable-logging" };
+    argv.insert(argv.end(), options.begin(), options.end());
+    engine.initialize(static_cast<int>(argv.size()), argv.data());
+    std::istringstream is(input);
+    std::ostringstream os;
+    engine.main_loop(is, os);
+    return os.str();
+  }
+
+  //! Output buffer keeping what was flushed
+  class FlushedBuffer : public std::stringbuf {
+    public:
+    std::string flushed()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return flushed_str;
+    }
+
+    size_t num_flushes()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return flushes;
+    }
+
+    protected:
+    int sync() override
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      flushed_str = str();
+      ++flushes;
+      return 0;
+    }
+
+    private:
+    std::mutex  mutex;
+    std::string flushed_str;
+    size_t      flushes = 0;
+  };
+
+  //! Wait for the condition up to 10 seconds
+  bool wait_until(const std::function<bool()>& done)
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while( !done() && std::chrono::steady_clock::now() < deadline ) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return done();
+  }
+
+  //! Pipe written with the input on its own thread, as '--threaded' reads a file descriptor
+  class PipedInput {
+    public:
+    explicit PipedInput(const std::string& input)
+    {
+      BOOST_REQUIRE_EQUAL( ::pipe(fds), 0 );
+      writer = std::thread([this, &input]{
+        for(size_t written = 0; written < input.size(); ) {
+          auto size = ::write(fds[1], input.data() + written, input.size() - written);
+          if(size <= 0) break;
+          written += static_cast<size_t>(size);
+        }
+        ::close(fds[1]);
+      });
+    }
+
+    // Input not read by the loop has to fit in the pipe
+    ~PipedInput()
+    {
+      writer.join();
+      ::close(fds[0]);
+    }
+
+    int fd() const noexcept
+    {
+      return fds[0];
+    }
+
+    private:
+    int         fds[2];
+    std::thread writer;
+  };
+
+  //! Same as run(), reading the input from a pipe
+  template<class E = Engine>
+  std::string run_piped(std::initializer_list<const char*> options, const std::string& input, E&& engine = E())
+  {
+    std::vector<const char*> argv{ "engine_test", "--disable-logging" };
+    argv.insert(argv.end(), options.begin(), options.end());
+    engine.initialize(static_cast<int>(argv.size()), argv.data());
+    PipedInput piped(input);
+    std::ostringstream os;
+    engine.main_loop(piped.fd(), os);
+    return os.str();
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( engine_test )
+
+  BOOST_AUTO_TEST_CASE( test_response_framing )
+  {
+    auto output = run({}, "echo hello\n# comment\nunknown\nquit\n");
+    BOOST_CHECK_EQUAL( output,
+                       "> \004= hello\n\004\n"
+                       "> > \004? unknown command: unknown\n\004\n"
+                       "> \004= \n\004\n" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_prompt_flushed )
+  {
+    // The prompt is shown before the loop waits for input
+    int fds[2];
+    BOOST_REQUIRE_EQUAL( ::pipe(fds), 0 );
+    Engine engine;
+    const char* argv[] = { "engine_test", "--disable-logging" };
+    engine.initialize(2, argv);
+    FlushedBuffer buffer;
+    std::ostream os(&buffer);
+    auto result = std::async(std::launch::async, [&]{ return engine.main_loop(fds[0], os); });
+    BOOST_CHECK( wait_until([&]{ return buffer.flushed() == "> "; }) );
+    const std::string input = "echo a\n";
+    BOOST_REQUIRE_EQUAL( ::write(fds[1], input.data(), input.size()), static_cast<ssize_t>(input.size()) );
+    BOOST_CHECK( wait_until([&]{ return buffer.flushed() == "> \004= a\n\004\n> "; }) );
+    ::close(fds[1]);
+    BOOST_CHECK_EQUAL( result.get(), EXIT_SUCCESS );
+    ::close(fds[0]);
+  }
+
+  BOOST_AUTO_TEST_CASE( test_end_of_input )
+  {
+    auto output = run({}, "echo hello\n");
+    BOOST_CHECK_EQUAL( output, "> \004= hello\n\004\n> \004" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_pipelined_framing )
+  {
+    const std::string input = "echo 1\necho 2\n\nunknown\necho 3\nquit\necho 4\n";
+    BOOST_CHECK_EQUAL( run({ "--pipelined" }, input), run({}, input) );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_pipelined_flushes )
+  {
+    // Responses are flushed once per batch of buffered commands, while the serial
+    // loop flushes each of them
+    const std::string first = "echo 1\necho 2\n# comment\nunknown\n";
+    const std::string second = "echo 3\necho 4\necho 5\n";
+    const auto count_flushes = [&](std::initializer_list<const char*> options){
+      std::vector<const char*> argv{ "engine_test", "--disable-logging" };
+      argv.insert(argv.end(), options.begin(), options.end());
+      Engine engine;
+      engine.initialize(static_cast<int>(argv.size()), argv.data());
+      int fds[2];
+      BOOST_REQUIRE_EQUAL( ::pipe(fds), 0 );
+      FlushedBuffer buffer;
+      std::ostream os(&buffer);
+      auto result = std::async(std::launch::async, [&]{ return engine.main_loop(fds[0], os); });
+      BOOST_CHECK( wait_until([&]{ return buffer.flushed() == "> "; }) );
+      // Each batch is written after the responses of the previous one are flushed
+      std::string input;
+      for(const auto& batch : { first, second }) {
+        BOOST_REQUIRE_EQUAL( ::write(fds[1], batch.data(), batch.size()), static_cast<ssize_t>(batch.size()) );
+        input += batch;
+        auto responded = run({}, input);
+        responded.pop_back();  // EOT at the end of input
+        BOOST_CHECK( wait_until([&]{ return buffer.flushed() == responded; }) );
+      }
+      ::close(fds[1]);
+      BOOST_CHECK_EQUAL( result.get(), EXIT_SUCCESS );
+      ::close(fds[0]);
+      BOOST_CHECK_EQUAL( buffer.flushed(), run({}, first + second) );
+      return buffer.num_flushes();
+    };
+    // The first prompt, 7 commands in 2 batches, and the end of input
+    BOOST_CHECK_GE( count_flushes({}), 9u );
+    BOOST_CHECK_EQUAL( count_flushes({ "--pipelined" }), 4u );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_concurrent_commands )
+  {
+    std::string input;
+    for(auto i = 0; i < 64; ++i) {
+      input += "square " + std::to_string(i) + "\n";
+      if(i % 16 == 0) input += "# comment\nunknown\n";
+      if(i == 40) input += "echo barrier\nhelp\n";
+    }
+    input += "quit\nsquare 1\n";
+
+    TestEngine engine;
+    auto output = run({ "--pipelined", "--workers", "4" }, input, engine);
+    BOOST_CHECK_EQUAL( output, run<TestEngine>({}, input) );
+    BOOST_CHECK( engine.threads.size() > 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_aborted_before_barrier )
+  {
+    // A command aborted in a batch stops the loop before the barrier runs
+    class AbortingEngine : public Engine {
+      public:
+      AbortingEngine()
+      {
+        register_callback("abort", [](Command&){
+          throw std::runtime_error("aborted");
+        }, "Abort", CallbackAttribute::CONCURRENT);
+        register_callback("mark", [this](Command&){
+          ++marks;
+        });
+      }
+
+      int marks = 0;
+    };
+
+    const std::string input = "echo 1\nabort\nmark\n";
+    AbortingEngine pipelined;
+    BOOST_CHECK_EQUAL( run({ "--pipelined" }, input, pipelined), run<AbortingEngine>({}, input) );
+    BOOST_CHECK_EQUAL( pipelined.marks, 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_failure_paths )
+  {
+    auto output = run<FailingEngine>({}, "throw 1\nfail 1 2\necho\nlist_commands 1\n"
+                                          "add 1 2\nadd 1\nadd 1 10\necho ok\n");
+    BOOST_CHECK_EQUAL( output,
+                       "> \004? thrown: 1\n\004\n"
+                       "> \004? failed: 2\n\004\n"
+                       "> \004? Command 'echo' requires 1 argument at least\n\004\n"
+                       "> \004? Command 'list_commands' requires no argument\n\004\n"
+                       "> \004= 3\n\004\n"
+                       "> \004? Command 'add' requires 2 arguments\n\004\n"
+                       "> \004? Command 'add' requires an integer in [0, 9] for 'rhs': 10\n\004\n"
+                       "> \004= ok\n\004\n"
+                       "> \004" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_register_and_remove )
+  {
+    RegisteringEngine engine;
+    engine.register_callback("cube",
+                             std::unique_ptr<CallbackFunction>(new CallbackMemberFunction<RegisteringEngine>(&engine, &RegisteringEngine::cube)));
+    BOOST_CHECK( engine.remove_callback("Square") );
+    BOOST_CHECK( !engine.remove_callback("square") );
+    BOOST_CHECK( engine.is_registered("CUBE") );
+    BOOST_CHECK( !engine.is_registered("square") );
+    BOOST_CHECK_EQUAL( run({}, "cube 3\nsquare 3\n", engine),
+                       "> \004= 27\n\004\n"
+                       "> \004? unknown command: square\n\004\n"
+                       "> \004" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_binary_protocol )
+  {
+    std::string input = "echo text\nprotocol binary\n";
+    frame::encode_request({ "echo", "hello  world", "!" }, input);
+    frame::encode_request({ "square", "7" }, input);
+    frame::encode_request({ "unknown" }, input);
+    input += std::string("\x04\0\0\0\x01\0\0\0", 8);  // a token longer than the frame
+    frame::encode_request({ "protocol", "text" }, input);
+    input += "echo back\n";
+
+    const std::initializer_list<const char*> modes[] = { {}, { "--pipelined" }, { "--threaded" } };
+    for(auto options : modes) {
+      auto output = run_piped<TestEngine>(options, input);
+      const std::string head = "> \004= text\n\004\n> \004= binary\n\004\n";
+      BOOST_REQUIRE_EQUAL( output.compare(0, head.size(), head), 0 );
+
+      boost::string_ref frames(output);
+      frames.remove_prefix(head.size());
+      ResponseStatus status;
+      boost::string_ref response;
+      const std::vector<std::pair<ResponseStatus, std::string>> expected{
+        { ResponseStatus::ACCEPTED, "hello  world !" },
+        { ResponseStatus::ACCEPTED, "49" },
+        { ResponseStatus::FAILED,   "unknown command: unknown" },
+        { ResponseStatus::FAILED,   "malformed request" },
+        { ResponseStatus::ACCEPTED, "text" }
+      };
+      for(const auto& e : expected) {
+        BOOST_REQUIRE( frame::decode_response(frames, status, response) );
+        BOOST_CHECK( status == e.first );
+        BOOST_CHECK_EQUAL( response, e.second );
+      }
+      BOOST_CHECK_EQUAL( frames, "> \004= back\n\004\n> \004" );
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE( test_script )
+  {
+    const auto path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("cli_script_test-%%%%%%%%");
+    {
+      std::ofstream script(path.string());
+      script << "# comment\n\nsquare 3\n  echo  hello  \nunknown\nquit\necho never\n";
+    }
+    const auto run_script = [&](std::initializer_list<const char*> options, std::string& output){
+      std::vector<const char*> argv{ "engine_test", "--disable-logging" };
+      argv.insert(argv.end(), options.begin(), options.end());
+      TestEngine engine;
+      engine.initialize(static_cast<int>(argv.size()), argv.data());
+      std::ostringstream os;
+      auto result = engine.run_script(path.string(), os);
+      output = os.str();
+      return result;
+    };
+
+    std::string output;
+    BOOST_CHECK_EQUAL( run_script({}, output), EXIT_FAILURE );
+    BOOST_CHECK_EQUAL( output,
+                       "= 9\n\004\n"
+                       "= hello\n\004\n"
+                       "? unknown command: unknown\n\004\n"
+                       "= \n\004\n" );
+    BOOST_CHECK_EQUAL( run_script({ "--quiet" }, output), EXIT_FAILURE );
+    BOOST_CHECK_EQUAL( output, "" );
+
+    // The last line need not be terminated
+    {
+      std::ofstream script(path.string());
+      script << "echo 1\necho 2";
+    }
+    BOOST_CHECK_EQUAL( run_script({}, output), EXIT_SUCCESS );
+    BOOST_CHECK_EQUAL( output, "= 1\n\004\n= 2\n\004\n" );
+
+    boost::filesystem::remove(path);
+    BOOST_CHECK_EQUAL( run_script({}, output), EXIT_FAILURE );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_response_cache )
+  {
+    const std::string input = "get a\nGET a\nget b\nget\nget\nset 1\nget a\nget a\n";
+    CachingEngine engine;
+    auto output = run({}, input, engine);
+    BOOST_CHECK_EQUAL( output, run<CachingEngine>({ "--cache-size", "0" }, input) );
+    BOOST_CHECK( output.find("= a=0\n\004\n> \004= a=0\n\004\n> \004= b=0\n") != std::string::npos );
+    BOOST_CHECK( output.find("= a=1\n\004\n> \004= a=1\n") != std::string::npos );
+    // Failures are not cached
+    BOOST_CHECK_EQUAL( engine.calls, 3 );
+    BOOST_CHECK_EQUAL( engine.response_cache().hits(), 2 );
+    BOOST_CHECK_EQUAL( engine.response_cache().misses(), 5 );
+
+    // Registering commands invalidates list_commands and help
+    CachingEngine registered;
+    const char* argv[] = { "engine_test", "--disable-logging" };
+    registered.initialize(2, argv);
+    std::istringstream is("list_commands\nlist_commands\n");
+    std::ostringstream os;
+    registered.main_loop(is, os);
+    registered.register_callback("added", [](Command&){});
+    is.clear();
+    is.str("list_commands\n");
+    os.str("");
+    registered.main_loop(is, os);
+    BOOST_CHECK( os.str().find("added\n") != std::string::npos );
+    BOOST_CHECK_EQUAL( registered.response_cache().hits(), 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_scratch )
+  {
+    std::string input;
+    for(auto i = 0; i < 100; ++i) input += "reverse a b " + std::to_string(i) + "\n";
+    ScratchEngine engine;
+    auto output = run({}, input, engine);
+    BOOST_CHECK( output.find("= 99 b a \n") != std::string::npos );
+    // Each command would need a new block if the arena was not reset
+    BOOST_CHECK_EQUAL( engine.max_capacity.load(), Arena::DEFAULT_BLOCK_SIZE );
+
+    ScratchEngine pipelined;
+    BOOST_CHECK_EQUAL( run({ "--pipelined", "--workers", "4" }, input, pipelined), output );
+    BOOST_CHECK_EQUAL( pipelined.max_capacity.load(), Arena::DEFAULT_BLOCK_SIZE );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_jobs )
+  {
+    BOOST_CHECK_EQUAL( run<JobEngine>({}, "count 3\n"),
+                       "> \004~ 1/3\n~ 2/3\n~ 3/3\n= counted 3\n\004\n> \004" );
+    BOOST_CHECK_EQUAL( run<JobEngine>({}, "count 0\ncount 1001\nexplode\n"),
+                       "> \004= nothing to count\n\004\n"
+                       "> \004? Command 'count' requires an integer in [0, 1000] for 'total': 1001\n\004\n"
+                       "> \004~ igniting\n~ burning\n? exploded\n\004\n> \004" );
+
+    // The following commands run while the jobs make steps, and respond in order
+    const std::string input = "count 3\necho a\n# comment\ncount 2\necho b\n";
+    auto output = run<JobEngine>({}, input);
+    BOOST_CHECK_EQUAL( output,
+                       "> \004~ 1/3\n~ 2/3\n~ 3/3\n= counted 3\n\004\n"
+                       "> \004= a\n\004\n"
+                       "> > \004~ 1/2\n~ 2/2\n= counted 2\n\004\n"
+                       "> \004= b\n\004\n> \004" );
+    // Other loops run jobs in place without progress
+    BOOST_CHECK_EQUAL( run<JobEngine>({ "--pipelined" }, input), without_progress(output) );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_cancel_jobs )
+  {
+    BOOST_CHECK_EQUAL( run<JobEngine>({}, "count 100\necho a\ncancel\necho b\ncancel\n"),
+                       "> \004~ 1/100\n~ 2/100\n? cancelled\n\004\n"
+                       "> \004= a\n\004\n"
+                       "> \004= 1 job cancelled\n\004\n"
+                       "> \004= b\n\004\n"
+                       "> \004= 0 jobs cancelled\n\004\n> \004" );
+    BOOST_CHECK_EQUAL( run<JobEngine>({}, "count 100\ncount 2\ncancel COUNT\n"),
+                       "> \004~ 1/100\n~ 2/100\n? cancelled\n\004\n"
+                       "> \004~ 1/2\n? cancelled\n\004\n"
+                       "> \004= 2 jobs cancelled\n\004\n> \004" );
+    // Quit cancels the running jobs
+    BOOST_CHECK_EQUAL( run<JobEngine>({}, "count 100\nquit\necho c\n"),
+                       "> \004~ 1/100\n? cancelled\n\004\n> \004= \n\004\n" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_jobs_with_partial_line )
+  {
+    // Jobs keep running while a line is written in pieces
+    class SpinningEngine : public Engine {
+      public:
+      SpinningEngine()
+      {
+        register_job("spin", [this](Command&) -> Job {
+          return [this](JobContext&) {
+            ++steps;
+            return stopped.load();
+          };
+        });
+      }
+
+      std::atomic<size_t> steps{ 0 };
+      std::atomic<bool>   stopped{ false };
+    };
+    int fds[2];
+    BOOST_REQUIRE_EQUAL( ::pipe(fds), 0 );
+    const auto write = [&](const std::string& input){
+      BOOST_REQUIRE_EQUAL( ::write(fds[1], input.data(), input.size()), static_cast<ssize_t>(input.size()) );
+    };
+    SpinningEngine engine;
+    const char* argv[] = { "engine_test", "--disable-logging" };
+    engine.initialize(2, argv);
+    std::ostringstream os;
+    write("spin\n");
+    auto result = std::async(std::launch::async, [&]{ return engine.main_loop(fds[0], os); });
+    BOOST_CHECK( wait_until([&]{ return engine.steps > 0; }) );
+    write("ec");
+    const size_t steps = engine.steps;
+    const bool spinning = wait_until([&]{ return engine.steps > steps + 100; });
+    engine.stopped = true;
+    write("ho a\n");
+    ::close(fds[1]);
+    BOOST_CHECK_EQUAL( result.get(), EXIT_SUCCESS );
+    ::close(fds[0]);
+    BOOST_CHECK( spinning );
+    BOOST_CHECK_EQUAL( os.str(), "> \004= \n\004\n> \004= a\n\004\n> \004" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_threaded_loop )
+  {
+    // More commands than the slots in flight
+    std::string input;
+    for(auto i = 0; i < 3000; ++i) {
+      input += "echo " + std::to_string(i) + "\n";
+      if(i % 100 == 0) input += "# comment\n\nunknown\n";
+    }
+    BOOST_CHECK_EQUAL( run_piped({ "--threaded" }, input), run({}, input) );
+
+    for(const std::string others : { "echo 1\nquit\necho 2\n", "echo 1\necho 2" }) {
+      BOOST_CHECK_EQUAL( run_piped({ "--threaded" }, others), run({}, others) );
+    }
+    const std::string failures = "throw 1\nfail 1 2\nadd 1 10\n";
+    BOOST_CHECK_EQUAL( run_piped<FailingEngine>({ "--threaded" }, failures), run<FailingEngine>({}, failures) );
+    const std::string jobs = "count 3\necho a\ncount 0\n";
+    BOOST_CHECK_EQUAL( run_piped<JobEngine>({ "--threaded" }, jobs), without_progress(run<JobEngine>({}, jobs)) );
+
+    // Stream buffers, which may block without a way to stop the reader, run the text loop
+    BOOST_CHECK_EQUAL( run<JobEngine>({ "--threaded" }, jobs), run<JobEngine>({}, jobs) );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_threaded_write_error )
+  {
+    // The recorder fails writing a full device, on the writer thread
+    std::string input;
+    for(auto i = 0; i < 3000; ++i) input += "echo " + std::to_string(i) + "\n";
+    for(auto threaded : { false, true }) {
+      std::vector<const char*> argv{ "engine_test", "--disable-logging", "--record", "/dev/full" };
+      if(threaded) argv.push_back("--threaded");
+      Engine engine;
+      engine.initialize(static_cast<int>(argv.size()), argv.data());
+      PipedInput piped(input);
+      std::ostringstream os;
+      BOOST_CHECK_EQUAL( engine.main_loop(piped.fd(), os), EXIT_FAILURE );
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE( test_threaded_quit )
+  {
+    // Quit stops the reader waiting for the input which does not end
+    int fds[2];
+    BOOST_REQUIRE_EQUAL( ::pipe(fds), 0 );
+    const std::string input = "echo open\nquit\n";
+    BOOST_REQUIRE_EQUAL( ::write(fds[1], input.data(), input.size()), static_cast<ssize_t>(input.size()) );
+
+    Engine engine;
+    const char* argv[] = { "engine_test", "--disable-logging", "--threaded" };
+    engine.initialize(3, argv);
+    std::ostringstream os;
+    auto result = std::async(std::launch::async, [&]{ return engine.main_loop(fds[0], os); });
+    const bool stopped = result.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    ::close(fds[1]);
+    BOOST_CHECK_EQUAL( result.get(), EXIT_SUCCESS );
+    ::close(fds[0]);
+    BOOST_CHECK( stopped );
+    BOOST_CHECK_EQUAL( os.str(), "> \004= open\n\004\n> \004= \n\004\n" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_stats )
+  {
+    BOOST_CHECK_EQUAL( run({}, "stats\n"),
+                       "> \004? statistics are disabled; run with '--stats'\n\004\n> \004" );
+
+    const auto output = run<TestEngine>({ "--stats" }, "square 3\nsquare 4\nECHO\nunknown\nstats\n"
+                                                       "stats reset\nstats\nstats all\n");
+    // Rows of the tables as "name calls errors"
+    std::istringstream lines(output);
+    std::string line;
+    std::vector<std::string> rows;
+    while( std::getline(lines, line) ) {
+      std::istringstream columns(line);
+      std::string name, calls, errors;
+      if( !(columns >> name >> calls >> errors) || name.find_first_of("=?>") != std::string::npos ) continue;
+      rows.push_back(name + ' ' + calls + ' ' + errors);
+    }
+    const std::vector<std::string> expected{
+      "command calls errors",
+      "echo 1 1",
+      "square 2 0",
+      "response cache: 0",
+      // after the reset
+      "command calls errors",
+      "stats 1 0",
+      "response cache: 0"
+    };
+    BOOST_CHECK_EQUAL_COLLECTIONS( rows.begin(), rows.end(), expected.begin(), expected.end() );
+    BOOST_CHECK( output.find("? unknown argument of stats: all") != std::string::npos );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -30,4 +30,42 @@ BOOST_AUTO_TEST_SUITE( hash_map_test )
     }
   }
 
+  BOOST_AUTO_TEST_CASE( test_fold_across_words )
+  {
+    InsensitiveEqual comp;
+    InsensitiveHash hash;
+    const std::string lower = "abcdefghijklmnopqrstuvwxyz@[`{0123456789";
+    for(size_t size = 0; size <= lower.size(); ++size) {
+      auto str_1 = lower.substr(0, size);
+      auto str_2 = str_1;
+      for(auto& c : str_2) c = static_cast<char>(::toupper(c));
+      BOOST_CHECK( comp(str_1,str_2) );
+      BOOST_CHECK_EQUAL( hash(str_1), hash(str_2) );
+    }
+    // Neighbours of letters are not folded
+    BOOST_CHECK( !comp("@[`{", "`{@[") );
+    BOOST_CHECK( !comp("test_command", "test_commane") );
+    BOOST_CHECK( !comp("test", "tests") );
+    // Non-ASCII bytes are compared as they are
+    BOOST_CHECK( !comp("\xc1", "\xe1") );
+    BOOST_CHECK( comp("\xc1x", "\xc1X") );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_find_by_view )
+  {
+    HashMap<int> map;
+    map.emplace("echo", 1);
+    map.emplace("list_commands", 2);
+    const auto& const_map = map;
+
+    const char line[] = "LIST_COMMANDS arg";
+    auto it = map.find(boost::string_ref(line, 13));
+    BOOST_REQUIRE( it != map.end() );
+    BOOST_CHECK_EQUAL( it->second, 2 );
+    BOOST_CHECK( const_map.find(boost::string_ref("Echo")) != const_map.end() );
+    BOOST_CHECK( map.find(boost::string_ref("ech")) == map.end() );
+    BOOST_CHECK_EQUAL( map.count("ECHO"), 1u );
+    BOOST_CHECK_EQUAL( map.count("quit"), 0u );
+  }
+
 BOOST_AUTO_TEST_SUITE_END()
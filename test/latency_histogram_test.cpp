@@ -0,0 +1,62 @@
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include "../latency_histogram.hpp"
+
+
+using namespace cli;
+
+
+BOOST_AUTO_TEST_SUITE( latency_histogram_test )
+
+  BOOST_AUTO_TEST_CASE( test_buckets )
+  {
+    // Buckets are contiguous, and values are within the relative error of their bucket
+    uint64_t value = 0;
+    for(size_t i = 0; i + 1 < LatencyHistogram::NUM_BUCKETS; ++i) {
+      const auto upper = LatencyHistogram::bucket_upper_bound(i);
+      BOOST_REQUIRE_EQUAL( LatencyHistogram::bucket_index(value), i );
+      BOOST_REQUIRE_EQUAL( LatencyHistogram::bucket_index(upper), i );
+      BOOST_REQUIRE( upper - value <= value / LatencyHistogram::SUB_BUCKETS );
+      value = upper + 1;
+    }
+    BOOST_CHECK_EQUAL( LatencyHistogram::bucket_index(~uint64_t(0)), LatencyHistogram::NUM_BUCKETS - 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_percentile )
+  {
+    LatencyHistogram histogram;
+    BOOST_CHECK_EQUAL( histogram.count(), 0 );
+    BOOST_CHECK_EQUAL( histogram.percentile(0.5), 0 );
+
+    for(uint64_t i = 1; i <= 1000; ++i) histogram.record(i * 1000);
+    BOOST_CHECK_EQUAL( histogram.count(), 1000 );
+    BOOST_CHECK_EQUAL( histogram.max(), 1000000 );
+    for(auto ratio : { 0.5, 0.9, 0.99, 0.999 }) {
+      const auto expected = static_cast<double>(ratio * 1000000);
+      BOOST_CHECK_CLOSE( static_cast<double>(histogram.percentile(ratio)), expected, 100.0 / LatencyHistogram::SUB_BUCKETS );
+      BOOST_CHECK( histogram.percentile(ratio) >= expected );
+    }
+    BOOST_CHECK_EQUAL( histogram.percentile(1.0), 1000000 );
+
+    histogram.reset();
+    BOOST_CHECK_EQUAL( histogram.count(), 0 );
+    BOOST_CHECK_EQUAL( histogram.max(), 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_concurrent_record )
+  {
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for(uint64_t t = 0; t < 4; ++t) {
+      threads.emplace_back([&histogram, t]{
+        for(uint64_t i = 0; i < 10000; ++i) histogram.record(t * 10000 + i);
+      });
+    }
+    for(auto& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL( histogram.count(), 40000 );
+    BOOST_CHECK_EQUAL( histogram.max(), 39999 );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
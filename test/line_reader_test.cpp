@@ -0,0 +1,85 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+#include "../line_reader.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  std::vector<std::string> read_all(LineReader& reader)
+  {
+    std::vector<std::string> lines;
+    LineReader::line_type line;
+    while( reader.next(line) ) lines.emplace_back(line.to_string());
+    return lines;
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( line_reader_test )
+
+  BOOST_AUTO_TEST_CASE( test_read_lines )
+  {
+    std::istringstream is("first\n\nsecond line\nlast");
+    LineReader reader(is.rdbuf());
+    auto lines = read_all(reader);
+    BOOST_REQUIRE_EQUAL( lines.size(), 4 );
+    BOOST_CHECK_EQUAL( lines[0], "first" );
+    BOOST_CHECK_EQUAL( lines[1], "" );
+    BOOST_CHECK_EQUAL( lines[2], "second line" );
+    BOOST_CHECK_EQUAL( lines[3], "last" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_partial_lines )
+  {
+    // Lines longer than the buffer are carried across reads
+    std::istringstream is("a very long line\nshort\nanother long line\n");
+    LineReader reader(is.rdbuf(), 4);
+    auto lines = read_all(reader);
+    BOOST_REQUIRE_EQUAL( lines.size(), 3 );
+    BOOST_CHECK_EQUAL( lines[0], "a very long line" );
+    BOOST_CHECK_EQUAL( lines[1], "short" );
+    BOOST_CHECK_EQUAL( lines[2], "another long line" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_file_descriptor )
+  {
+    int fds[2];
+    BOOST_REQUIRE_EQUAL( ::pipe(fds), 0 );
+    LineReader reader(fds[0], 8);
+    BOOST_CHECK( !reader.wait(1) );
+
+    const std::string first = "echo par";
+    BOOST_REQUIRE_EQUAL( ::write(fds[1], first.data(), first.size()), first.size() );
+    BOOST_CHECK( reader.buffered() );
+    BOOST_CHECK( reader.wait(0) );
+
+    const std::string second = "tial\nquit\n";
+    BOOST_REQUIRE_EQUAL( ::write(fds[1], second.data(), second.size()), second.size() );
+    ::close(fds[1]);
+
+    auto lines = read_all(reader);
+    ::close(fds[0]);
+    BOOST_REQUIRE_EQUAL( lines.size(), 2 );
+    BOOST_CHECK_EQUAL( lines[0], "echo partial" );
+    BOOST_CHECK_EQUAL( lines[1], "quit" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_command_line )
+  {
+    BOOST_CHECK( is_command_line("echo") );
+    BOOST_CHECK( is_command_line("  # not a comment") );
+    BOOST_CHECK( !is_command_line("# comment") );
+    BOOST_CHECK( !is_command_line("") );
+    BOOST_CHECK_EQUAL( trim_line(" \techo  test \r"), "echo  test" );
+    BOOST_CHECK_EQUAL( trim_line("   "), "" );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,155 @@
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+#include "../logger.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  class LogDirFixture {
+    public:
+    LogDirFixture()
+      : dir(boost::filesystem::temp_directory_path() / ("cli_logger_test_" + std::to_string(::getpid())))
+    {
+    }
+
+    ~LogDirFixture()
+    {
+      boost::filesystem::remove_all(dir);
+    }
+
+    std::vector<std::string> lines(const std::string& filename) const
+    {
+      std::ifstream file((dir / filename).string());
+      std::vector<std::string> result;
+      for(std::string line; std::getline(file, line); ) result.push_back(line);
+      return result;
+    }
+
+    size_t count(const std::string& filename, const std::string& pattern) const
+    {
+      size_t num = 0;
+      for(const auto& line : lines(filename)) {
+        if(line.find(pattern) != std::string::npos) ++num;
+      }
+      return num;
+    }
+
+    boost::filesystem::path dir;
+  };
+
+}
+
+
+BOOST_FIXTURE_TEST_SUITE( logger_test, LogDirFixture )
+
+  BOOST_AUTO_TEST_CASE( test_sync )
+  {
+    Logger logger;
+    BOOST_REQUIRE( logger.open("sync.log", dir.string()) );
+    logger.info() << "message " << 1;
+    auto lines = this->lines("sync.log");
+    BOOST_REQUIRE_EQUAL( lines.size(), 2 );
+    BOOST_CHECK( lines[1].find("INFO  : message 1") != std::string::npos );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_async_block )
+  {
+    Logger logger;
+    logger.set_async(8, LogOverflow::BLOCK);
+    BOOST_REQUIRE( logger.open("block.log", dir.string()) );
+    std::vector<std::thread> threads;
+    for(auto t = 0; t < 4; ++t) {
+      threads.emplace_back([&]{ for(auto i = 0; i < 1000; ++i) logger.debug() << "record " << i; });
+    }
+    for(auto& thread : threads) thread.join();
+    logger.close();
+    BOOST_CHECK_EQUAL( count("block.log", "DEBUG : record "), 4000 );
+    BOOST_CHECK_EQUAL( logger.num_dropped(), 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_async_count )
+  {
+    Logger logger;
+    logger.set_async(2, LogOverflow::COUNT);
+    BOOST_REQUIRE( logger.open("count.log", dir.string()) );
+    for(auto i = 0; i < 10000; ++i) logger.debug() << "record";
+    logger.close();
+    // Reports of dropped records may be dropped as well
+    BOOST_CHECK( count("count.log", "DEBUG : record") + logger.num_dropped() >= 10000 );
+    BOOST_CHECK( count("count.log", "log records were dropped") > 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_async_count_over_threshold )
+  {
+    // Drops are reported even when warnings are filtered
+    Logger logger;
+    logger.set_threshold(LogLevel::ERROR);
+    logger.set_async(2, LogOverflow::COUNT);
+    BOOST_REQUIRE( logger.open("count_error.log", dir.string()) );
+    for(auto i = 0; i < 10000; ++i) logger.error() << "record";
+    logger.close();
+    BOOST_CHECK( count("count_error.log", "WARN  : ") > 0 );
+    BOOST_CHECK( count("count_error.log", "log records were dropped") > 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_fatal_flush )
+  {
+    Logger logger;
+    logger.set_async(1024, LogOverflow::BLOCK);
+    BOOST_REQUIRE( logger.open("fatal.log", dir.string()) );
+    for(auto i = 0; i < 100; ++i) logger.info() << "record";
+    logger.fatal() << "fatal";
+    BOOST_CHECK_EQUAL( count("fatal.log", "INFO  : record"), 100 );
+    BOOST_CHECK_EQUAL( count("fatal.log", "FATAL : fatal"), 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_threshold )
+  {
+    Logger logger;
+    logger.set_threshold(LogLevel::WARNING);
+    BOOST_REQUIRE( logger.open("threshold.log", dir.string()) );
+    BOOST_CHECK( !logger.enabled(LogLevel::INFO) );
+    BOOST_CHECK( logger.enabled(LogLevel::ERROR) );
+
+    auto evaluated = 0;
+    auto argument = [&]{ return ++evaluated; };
+    CLI_LOG(logger, INFO) << "filtered " << argument();
+    logger.debug() << "filtered";
+    CLI_LOG(logger, ERROR) << "written " << argument();
+    BOOST_CHECK_EQUAL( evaluated, 1 );
+    BOOST_CHECK_EQUAL( count("threshold.log", "filtered"), 0 );
+    BOOST_CHECK_EQUAL( count("threshold.log", "ERROR : written 1"), 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_disabled )
+  {
+    Logger logger;
+    auto evaluated = 0;
+    CLI_LOG(logger, FATAL) << ++evaluated;
+    BOOST_CHECK_EQUAL( evaluated, 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_default_path )
+  {
+    // Made on the first call, and kept for the process
+    const auto& filename = Logger::default_log_filename();
+    BOOST_CHECK( filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".log") == 0 );
+    BOOST_CHECK_EQUAL( &Logger::default_log_filename(), &filename );
+    BOOST_CHECK_EQUAL( Logger::default_log_dir(),
+                       boost::filesystem::current_path().string() + "/log" );
+
+    const std::string& default_filename = Logger::DEFAULT_LOG_FILENAME;
+    BOOST_CHECK_EQUAL( &default_filename, &filename );
+    BOOST_CHECK_EQUAL( Logger::DEFAULT_LOG_DIR.str(), Logger::default_log_dir() );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,67 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include "../protocol.hpp"
+
+
+using namespace cli;
+
+
+BOOST_AUTO_TEST_SUITE( protocol_test )
+
+  BOOST_AUTO_TEST_CASE( test_request )
+  {
+    std::string request;
+    frame::encode_request({ "echo", "hello world", "" }, request);
+    BOOST_REQUIRE_EQUAL( request.size(), frame::HEADER_SIZE + 4 + 3 * 4 + 4 + 11 );
+    BOOST_CHECK_EQUAL( frame::payload_size(request.data()), request.size() - frame::HEADER_SIZE );
+
+    std::vector<boost::string_ref> tokens;
+    BOOST_REQUIRE( frame::decode_request(boost::string_ref(request).substr(frame::HEADER_SIZE), tokens) );
+    BOOST_REQUIRE_EQUAL( tokens.size(), 3 );
+    BOOST_CHECK_EQUAL( tokens[0], "echo" );
+    BOOST_CHECK_EQUAL( tokens[1], "hello world" );
+    BOOST_CHECK_EQUAL( tokens[2], "" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_malformed_request )
+  {
+    std::string request;
+    frame::encode_request({ "echo", "hello" }, request);
+    const auto payload = boost::string_ref(request).substr(frame::HEADER_SIZE);
+
+    std::vector<boost::string_ref> tokens;
+    BOOST_CHECK( !frame::decode_request(payload.substr(0, payload.size() - 1), tokens) );
+    BOOST_CHECK( !frame::decode_request(request + 'x', tokens) );
+    BOOST_CHECK( !frame::decode_request("\xff\xff\xff\xff", tokens) );
+    BOOST_CHECK( !frame::decode_request("", tokens) );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_response )
+  {
+    std::ostringstream os;
+    frame::write_response(os, ResponseStatus::ACCEPTED, "hello");
+    frame::write_response(os, ResponseStatus::FAILED, "");
+    const auto output = os.str();
+    boost::string_ref input(output);
+
+    ResponseStatus   status;
+    boost::string_ref response;
+    BOOST_REQUIRE( frame::decode_response(input, status, response) );
+    BOOST_CHECK( status == ResponseStatus::ACCEPTED );
+    BOOST_CHECK_EQUAL( response, "hello" );
+    BOOST_REQUIRE( frame::decode_response(input, status, response) );
+    BOOST_CHECK( status == ResponseStatus::FAILED );
+    BOOST_CHECK_EQUAL( response, "" );
+    BOOST_CHECK( input.empty() );
+    BOOST_CHECK( !frame::decode_response(input, status, response) );
+
+    // Incomplete frames are left in the input
+    boost::string_ref partial(output.data(), 7);
+    BOOST_CHECK( !frame::decode_response(partial, status, response) );
+    BOOST_CHECK_EQUAL( partial.size(), 7 );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
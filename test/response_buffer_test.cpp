@@ -0,0 +1,214 @@
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+#include "../response_buffer.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  struct Point {
+    int x, y;
+  };
+
+  std::ostream& operator<<(std::ostream& os, const Point& p)
+  {
+    return os << '(' << p.x << ',' << p.y << ')';
+  }
+
+  template<class T>
+  std::string formatted_by_stream(const T& value)
+  {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+  }
+
+  template<class T>
+  std::string formatted_by_buffer(const T& value)
+  {
+    ResponseBuffer buffer;
+    buffer << value;
+    return buffer.str();
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( response_buffer_test )
+
+  BOOST_AUTO_TEST_CASE( test_strings )
+  {
+    ResponseBuffer buffer;
+    buffer << "literal" << ' ' << std::string("string") << ' ' << boost::string_ref("view");
+    BOOST_CHECK_EQUAL( buffer.str(), "literal string view" );
+    buffer.clear();
+    BOOST_CHECK( buffer.empty() );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_same_format_as_stream )
+  {
+    BOOST_CHECK_EQUAL( formatted_by_buffer(0), formatted_by_stream(0) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(-42), formatted_by_stream(-42) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(std::numeric_limits<long long>::min()),
+                       formatted_by_stream(std::numeric_limits<long long>::min()) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(std::numeric_limits<unsigned long long>::max()),
+                       formatted_by_stream(std::numeric_limits<unsigned long long>::max()) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(true), formatted_by_stream(true) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(0.5), formatted_by_stream(0.5) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(1.0 / 3.0), formatted_by_stream(1.0 / 3.0) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(1e100), formatted_by_stream(1e100) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(2.5f), formatted_by_stream(2.5f) );
+    BOOST_CHECK_EQUAL( formatted_by_buffer(Point{1, 2}), formatted_by_stream(Point{1, 2}) );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_manipulator )
+  {
+    ResponseBuffer buffer;
+    buffer << "line" << std::endl;
+    BOOST_CHECK_EQUAL( buffer.str(), "line\n" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_format )
+  {
+    ResponseBuffer buffer;
+    std::ostringstream stream;
+    const auto write = [](auto& os){
+      os << std::hex << 255 << ' ' << std::dec << 255 << ' '
+         << std::setw(5) << std::setfill('0') << 42 << ' '
+         << std::fixed << std::setprecision(2) << 3.14159 << ' '
+         << std::setw(4) << "ab" << '|' << std::boolalpha << true;
+    };
+    write(buffer);
+    write(stream);
+    BOOST_CHECK_EQUAL( buffer.str(), stream.str() );
+    BOOST_CHECK_EQUAL( buffer.str(), "ff 255 00042 3.14 00ab|true" );
+
+    // clear() restores the default format for the next response
+    buffer.clear();
+    buffer << 255 << ' ' << 0.5;
+    BOOST_CHECK_EQUAL( buffer.str(), "255 0.5" );
+  }
+
+  // Members of std::ostringstream, compared with the stream
+  //--------------------------------------------------------
+  BOOST_AUTO_TEST_CASE( test_precision )
+  {
+    ResponseBuffer buffer;
+    std::ostringstream stream;
+    const auto write = [](auto& os){
+      const auto previous = os.precision(3);
+      os << previous << ' ' << os.precision() << ' ' << 3.14159;
+    };
+    write(buffer);
+    write(stream);
+    BOOST_CHECK_EQUAL( buffer.str(), stream.str() );
+    BOOST_CHECK_EQUAL( buffer.str(), "6 3 3.14" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_write )
+  {
+    ResponseBuffer buffer;
+    std::ostringstream stream;
+    const auto write = [](auto& os){
+      os.width(8);
+      os.write("raw\0data", 8).write("!", 1);
+    };
+    write(buffer);
+    write(stream);
+    BOOST_CHECK_EQUAL( buffer.str(), stream.str() );
+    BOOST_CHECK_EQUAL( buffer.str(), std::string("raw\0data!", 9) );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_put )
+  {
+    ResponseBuffer buffer;
+    std::ostringstream stream;
+    const auto write = [](auto& os){
+      os << std::setw(3);
+      os.put('a').put('b');
+      os << 'c';
+    };
+    write(buffer);
+    write(stream);
+    BOOST_CHECK_EQUAL( buffer.str(), stream.str() );
+    BOOST_CHECK_EQUAL( buffer.str(), "ab  c" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_reset_by_str )
+  {
+    ResponseBuffer buffer;
+    std::ostringstream stream;
+    const auto write = [](auto& os){
+      os << std::hex << "previous " << 255;
+      os.str("");
+      os << 255;
+      os.str("replaced ");
+    };
+    write(buffer);
+    write(stream);
+    BOOST_CHECK_EQUAL( buffer.str(), stream.str() );
+    BOOST_CHECK_EQUAL( buffer.str(), "replaced " );
+
+    // The format is kept, as by std::ostringstream
+    buffer.str("");
+    buffer << 255;
+    BOOST_CHECK_EQUAL( buffer.str(), "ff" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_setf )
+  {
+    ResponseBuffer buffer;
+    std::ostringstream stream;
+    const auto write = [](auto& os){
+      os.setf(std::ios_base::showpos);
+      os << 1 << ' ';
+      os.setf(std::ios_base::hex, std::ios_base::basefield);
+      os.unsetf(std::ios_base::showpos);
+      os << 255 << ' ' << ((os.flags() & std::ios_base::hex) != 0);
+      os.flags(std::ios_base::dec);
+      os.fill('*');
+      os.width(4);
+      os << 7;
+    };
+    write(buffer);
+    write(stream);
+    BOOST_CHECK_EQUAL( buffer.str(), stream.str() );
+    BOOST_CHECK_EQUAL( buffer.str(), "+1 ff 1***7" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_as_ostream )
+  {
+    const auto write_point = [](std::ostream& os){ os << Point{3, 4}; };
+    ResponseBuffer buffer;
+    buffer << "point ";
+    write_point(buffer);
+    buffer << " done";
+    BOOST_CHECK_EQUAL( buffer.str(), "point (3,4) done" );
+
+    // The stream follows the content moved to another buffer
+    buffer << std::hex;
+    ResponseBuffer moved(std::move(buffer));
+    moved << ' ' << 255;
+    static_cast<std::ostream&>(moved) << '!';
+    BOOST_CHECK_EQUAL( moved.str(), "point (3,4) done ff!" );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_pool )
+  {
+    ResponsePool pool;
+    ResponseBuffer buffer( pool.acquire() );
+    buffer << std::string(1000, 'x');
+    const auto data = buffer.str().data();
+    pool.release( buffer.exchange({}) );
+
+    ResponseBuffer reused( pool.acquire() );
+    BOOST_CHECK( reused.empty() );
+    BOOST_CHECK_EQUAL( static_cast<const void*>(reused.str().data()), static_cast<const void*>(data) );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+#include "../command.hpp"
+#include "../response_cache.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  std::string key_of(const char* command_line)
+  {
+    std::string key;
+    ResponseCache::make_key(Command(command_line), key);
+    return key;
+  }
+
+  //! Returns the cached response, or "(none)"
+  std::string find(ResponseCache& cache, const char* command_line)
+  {
+    ResponseBuffer response;
+    return cache.find(key_of(command_line), response) ? response.str() : "(none)";
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( response_cache_test )
+
+  BOOST_AUTO_TEST_CASE( test_normalized_key )
+  {
+    BOOST_CHECK_EQUAL( key_of("Get  key"), key_of(" get key ") );
+    BOOST_CHECK_NE( key_of("get key"), key_of("get KEY") );
+    BOOST_CHECK_NE( key_of("get ab c"), key_of("get a bc") );
+    BOOST_CHECK_NE( key_of("get"), key_of("getx") );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_lru )
+  {
+    ResponseCache cache(2);
+    cache.insert(key_of("get a"), "A");
+    cache.insert(key_of("get b"), "B");
+    BOOST_CHECK_EQUAL( find(cache, "GET a"), "A" );
+    // b is the least recently used
+    cache.insert(key_of("get c"), "C");
+    BOOST_CHECK_EQUAL( cache.size(), 2 );
+    BOOST_CHECK_EQUAL( find(cache, "get b"), "(none)" );
+    BOOST_CHECK_EQUAL( find(cache, "get a"), "A" );
+    BOOST_CHECK_EQUAL( find(cache, "get c"), "C" );
+    BOOST_CHECK_EQUAL( cache.hits(), 3 );
+    BOOST_CHECK_EQUAL( cache.misses(), 1 );
+
+    cache.insert(key_of("get c"), "C2");
+    BOOST_CHECK_EQUAL( find(cache, "get c"), "C2" );
+    cache.set_capacity(1);
+    BOOST_CHECK_EQUAL( cache.size(), 1 );
+    BOOST_CHECK_EQUAL( find(cache, "get c"), "C2" );
+
+    cache.set_capacity(0);
+    cache.insert(key_of("get a"), "A");
+    BOOST_CHECK_EQUAL( cache.size(), 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_invalidate )
+  {
+    ResponseCache cache(8);
+    cache.insert(key_of("get a"), "A");
+    cache.insert(key_of("get b"), "B");
+    cache.insert(key_of("getx a"), "X");
+    cache.insert(key_of("list"), "L");
+    cache.invalidate("GET");
+    BOOST_CHECK_EQUAL( cache.size(), 2 );
+    BOOST_CHECK_EQUAL( find(cache, "get a"), "(none)" );
+    BOOST_CHECK_EQUAL( find(cache, "getx a"), "X" );
+    cache.invalidate();
+    BOOST_CHECK_EQUAL( cache.size(), 0 );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
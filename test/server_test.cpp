@@ -0,0 +1,206 @@
+#include <string>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../engine.hpp"
+#include "../protocol.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  int connect_to(const std::string& path)
+  {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    for(auto retry = 0; retry < 100; ++retry) {
+      if(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) return fd;
+      ::usleep(10000);
+    }
+    ::close(fd);
+    return -1;
+  }
+
+  void send_to(int fd, const std::string& message)
+  {
+    BOOST_REQUIRE_EQUAL( ::write(fd, message.data(), message.size()), message.size() );
+  }
+
+  std::string receive_until(int fd, const std::string& suffix)
+  {
+    std::string received;
+    char buffer[256];
+    while( received.size() < suffix.size() ||
+           received.compare(received.size() - suffix.size(), suffix.size(), suffix) != 0 ) {
+      auto size = ::read(fd, buffer, sizeof(buffer));
+      if(size <= 0) break;
+      received.append(buffer, size);
+    }
+    return received;
+  }
+
+  class ServerFixture {
+    public:
+    ServerFixture()
+      : path("/tmp/cli_basic_engine_test_" + std::to_string(::getpid()) + ".sock")
+    {
+      const char* argv[] = { "server_test", "--disable-logging" };
+      engine.initialize(2, argv);
+      thread = std::thread([this]{ engine.serve(path); });
+    }
+
+    ~ServerFixture()
+    {
+      // Retry until serve() has started its server
+      struct stat status;
+      do {
+        engine.stop();
+        ::usleep(1000);
+      } while( ::stat(path.c_str(), &status) == 0 );
+      thread.join();
+    }
+
+    Engine      engine;
+    std::string path;
+    std::thread thread;
+  };
+
+}
+
+
+BOOST_FIXTURE_TEST_SUITE( server_test, ServerFixture )
+
+  BOOST_AUTO_TEST_CASE( test_isolated_sessions )
+  {
+    auto first  = connect_to(path);
+    auto second = connect_to(path);
+    BOOST_REQUIRE( first >= 0 && second >= 0 );
+
+    // Partial lines are kept per session
+    send_to(first, "echo fir");
+    send_to(second, "echo second\n");
+    BOOST_CHECK_EQUAL( receive_until(second, "\004\n> "), "> \004= second\n\004\n> " );
+    send_to(first, "st\n");
+    BOOST_CHECK_EQUAL( receive_until(first, "\004\n> "), "> \004= first\n\004\n> " );
+
+    // Quit closes the session only
+    send_to(first, "quit\n");
+    BOOST_CHECK_EQUAL( receive_until(first, "\004\n"), "\004= \n\004\n" );
+    char c;
+    BOOST_CHECK_EQUAL( ::read(first, &c, 1), 0 );
+
+    send_to(second, "# comment\nunknown\n");
+    BOOST_CHECK_EQUAL( receive_until(second, "\004\n> "), "> \004? unknown command: unknown\n\004\n> " );
+
+    ::close(first);
+    ::close(second);
+  }
+
+  BOOST_AUTO_TEST_CASE( test_descriptor_exhaustion )
+  {
+    auto first = connect_to(path);
+    BOOST_REQUIRE( first >= 0 );
+    BOOST_REQUIRE_EQUAL( receive_until(first, "> "), "> " );
+
+    // Leave a single descriptor, which the next client takes, so the server cannot accept it
+    auto lowest = ::dup(0);
+    BOOST_REQUIRE( lowest >= 0 );
+    ::close(lowest);
+    rlimit original;
+    BOOST_REQUIRE( ::getrlimit(RLIMIT_NOFILE, &original) == 0 );
+    rlimit limited = original;
+    limited.rlim_cur = static_cast<rlim_t>(lowest) + 1;
+    BOOST_REQUIRE( ::setrlimit(RLIMIT_NOFILE, &limited) == 0 );
+    auto second = connect_to(path);
+    ::usleep(50000);
+
+    // Existing sessions are still served
+    send_to(first, "echo first\n");
+    auto received = receive_until(first, "\004\n> ");
+    ::setrlimit(RLIMIT_NOFILE, &original);
+    BOOST_CHECK_EQUAL( received, "\004= first\n\004\n> " );
+
+    // The waiting client is accepted once a session closes
+    BOOST_REQUIRE( second >= 0 );
+    ::close(first);
+    BOOST_CHECK_EQUAL( receive_until(second, "> "), "> " );
+    ::close(second);
+  }
+
+  BOOST_AUTO_TEST_CASE( test_long_line )
+  {
+    // A line which never ends closes the session rather than filling the memory
+    auto fd = connect_to(path);
+    BOOST_REQUIRE( fd >= 0 );
+    const std::string chunk(64 * 1024, 'x');
+    for(auto i = 0; i < 32; ++i) {
+      if(::send(fd, chunk.data(), chunk.size(), MSG_NOSIGNAL) < 0) break;
+    }
+    BOOST_CHECK_EQUAL( receive_until(fd, "\004\n"), "> \004? line too long\n\004\n" );
+    char c;
+    BOOST_CHECK_EQUAL( ::read(fd, &c, 1), 0 );
+    ::close(fd);
+  }
+
+  BOOST_AUTO_TEST_CASE( test_oversized_frame )
+  {
+    // A frame over the session limit is rejected by its header, before the payload
+    auto fd = connect_to(path);
+    BOOST_REQUIRE( fd >= 0 );
+    send_to(fd, "protocol binary\n");
+    BOOST_CHECK_EQUAL( receive_until(fd, "\004\n"), "> \004= binary\n\004\n" );
+
+    send_to(fd, std::string("\0\0\0\x01", 4));  // 16 MiB
+    auto received = receive_until(fd, "too large");
+    boost::string_ref input(received);
+    ResponseStatus status;
+    boost::string_ref response;
+    BOOST_REQUIRE( frame::decode_response(input, status, response) );
+    BOOST_CHECK( status == ResponseStatus::ABORTED );
+    BOOST_CHECK_EQUAL( response, "request frame too large" );
+    char c;
+    BOOST_CHECK_EQUAL( ::read(fd, &c, 1), 0 );
+    ::close(fd);
+  }
+
+  BOOST_AUTO_TEST_CASE( test_binary_session )
+  {
+    auto binary = connect_to(path);
+    auto text   = connect_to(path);
+    BOOST_REQUIRE( binary >= 0 && text >= 0 );
+
+    send_to(binary, "protocol binary\n");
+    BOOST_CHECK_EQUAL( receive_until(binary, "\004\n"), "> \004= binary\n\004\n" );
+
+    // Frames split across writes are kept per session
+    std::string request;
+    frame::encode_request({ "echo", "a b" }, request);
+    send_to(binary, request.substr(0, 6));
+    send_to(text, "echo text\n");
+    BOOST_CHECK_EQUAL( receive_until(text, "\004\n> "), "> \004= text\n\004\n> " );
+    send_to(binary, request.substr(6));
+    std::string expected;
+    expected.append("\x04\0\0\0\0a b", 8);
+    BOOST_CHECK_EQUAL( receive_until(binary, "a b"), expected );
+
+    // Switching back writes the prompt of the text protocol
+    request.clear();
+    frame::encode_request({ "protocol", "text" }, request);
+    send_to(binary, request);
+    expected.assign("\x05\0\0\0\0text> ", 11);
+    BOOST_CHECK_EQUAL( receive_until(binary, "> "), expected );
+
+    ::close(binary);
+    ::close(text);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,178 @@
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+#include "../session_record.hpp"
+#include "../engine.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  class SessionFileFixture {
+    public:
+    SessionFileFixture()
+      : path(boost::filesystem::temp_directory_path() / ("cli_session_test_" + std::to_string(::getpid()) + ".bin"))
+    {
+    }
+
+    ~SessionFileFixture()
+    {
+      boost::filesystem::remove(path);
+    }
+
+    boost::filesystem::path path;
+  };
+
+  constexpr std::chrono::milliseconds NAP(100);
+
+  std::string run(std::vector<const char*> options, const std::string& input)
+  {
+    std::vector<const char*> argv{ "session_record_test", "--disable-logging" };
+    argv.insert(argv.end(), options.begin(), options.end());
+    Engine engine;
+    engine.initialize(static_cast<int>(argv.size()), argv.data());
+    std::istringstream is(input);
+    std::ostringstream os;
+    engine.main_loop(is, os);
+    return os.str();
+  }
+
+  int replay(std::vector<const char*> options, const std::string& path, std::string& report)
+  {
+    std::vector<const char*> argv{ "session_record_test", "--disable-logging" };
+    argv.insert(argv.end(), options.begin(), options.end());
+    Engine engine;
+    engine.initialize(static_cast<int>(argv.size()), argv.data());
+    std::ostringstream os;
+    auto result = engine.replay(path, os);
+    report = os.str();
+    return result;
+  }
+
+}
+
+
+BOOST_FIXTURE_TEST_SUITE( session_record_test, SessionFileFixture )
+
+  BOOST_AUTO_TEST_CASE( test_round_trip )
+  {
+    const std::string long_command(100000, 'x');
+    {
+      SessionRecorder recorder(path.string());
+      recorder.record("echo hello", ResponseStatus::ACCEPTED, "hello");
+      recorder.record("", ResponseStatus::FAILED, "");
+      recorder.record(long_command, ResponseStatus::ABORTED, "error");
+    }
+
+    SessionReader reader(path.string());
+    BOOST_CHECK( reader.start_time() > 0 );
+    SessionRecord record;
+    BOOST_REQUIRE( reader.next(record) );
+    BOOST_CHECK_EQUAL( record.command, "echo hello" );
+    BOOST_CHECK( record.status == ResponseStatus::ACCEPTED );
+    BOOST_CHECK_EQUAL( record.response_size, 5u );
+    BOOST_CHECK_EQUAL( record.response_hash, hash_response("hello") );
+    const auto time = record.time;
+
+    BOOST_REQUIRE( reader.next(record) );
+    BOOST_CHECK_EQUAL( record.command, "" );
+    BOOST_CHECK( record.status == ResponseStatus::FAILED );
+    BOOST_CHECK( record.time >= time );
+
+    BOOST_REQUIRE( reader.next(record) );
+    BOOST_CHECK( record.command == long_command );
+    BOOST_CHECK( record.status == ResponseStatus::ABORTED );
+    BOOST_CHECK( !reader.next(record) );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_broken_file )
+  {
+    {
+      std::ofstream file(path.string());
+      file << "not a session file";
+    }
+    BOOST_CHECK_THROW( SessionReader(path.string()), std::runtime_error );
+
+    {
+      SessionRecorder recorder(path.string());
+      recorder.record("echo hello", ResponseStatus::ACCEPTED, "hello");
+    }
+    boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 1);
+    SessionReader reader(path.string());
+    SessionRecord record;
+    BOOST_CHECK_THROW( reader.next(record), std::runtime_error );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_record_and_replay )
+  {
+    const auto file = path.string();
+    const std::string input = "echo 1\n# comment\nunknown\necho\nlist_commands\nquit\n";
+    BOOST_CHECK_EQUAL( run({ "--record", file.c_str() }, input), run({}, input) );
+
+    std::string report;
+    BOOST_CHECK_EQUAL( replay({}, file, report), EXIT_SUCCESS );
+    BOOST_CHECK( report.find("replayed 5 commands") != std::string::npos );
+    BOOST_CHECK( report.find("mismatched responses: 0") != std::string::npos );
+    BOOST_CHECK_EQUAL( replay({ "--replay-pacing", "original" }, file, report), EXIT_SUCCESS );
+
+    run({ "--record", file.c_str(), "--pipelined" }, input);
+    BOOST_CHECK_EQUAL( replay({}, file, report), EXIT_SUCCESS );
+    BOOST_CHECK( report.find("replayed 5 commands") != std::string::npos );
+
+    // Different responses are reported
+    {
+      SessionRecorder recorder(file);
+      recorder.record("echo 1", ResponseStatus::ACCEPTED, "1");
+      recorder.record("echo 2", ResponseStatus::ACCEPTED, "3");
+      recorder.record("echo 3", ResponseStatus::FAILED, "3");
+    }
+    BOOST_CHECK_EQUAL( replay({}, file, report), EXIT_FAILURE );
+    BOOST_CHECK( report.find("mismatch at command 2: echo 2") != std::string::npos );
+    BOOST_CHECK( report.find("mismatch at command 3: echo 3") != std::string::npos );
+    BOOST_CHECK( report.find("mismatched responses: 2") != std::string::npos );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_received_time )
+  {
+    // Commands read ahead in a batch are recorded at their read time, not after the batch
+    class NappingEngine : public Engine {
+      public:
+      NappingEngine()
+      {
+        register_callback("nap", [](Command&){
+          std::this_thread::sleep_for(NAP);
+        }, "Sleep", CallbackAttribute::CONCURRENT);
+      }
+    };
+
+    const auto file = path.string();
+    const char* argv[] = { "session_record_test", "--disable-logging", "--pipelined", "--record", file.c_str() };
+    {
+      NappingEngine engine;
+      engine.initialize(5, argv);
+      std::istringstream is("nap\nnap\necho\n");
+      std::ostringstream os;
+      engine.main_loop(is, os);
+    }
+
+    SessionReader reader(file);
+    SessionRecord record;
+    size_t num_records = 0;
+    while( reader.next(record) ) {
+      ++num_records;
+      BOOST_CHECK( std::chrono::nanoseconds(record.time) < NAP );
+    }
+    BOOST_CHECK_EQUAL( num_records, 3 );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
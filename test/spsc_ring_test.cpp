@@ -0,0 +1,60 @@
+#include <string>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include "../spsc_ring.hpp"
+
+
+using namespace cli;
+
+BOOST_AUTO_TEST_SUITE( spsc_ring_test )
+
+  BOOST_AUTO_TEST_CASE( test_push_pop )
+  {
+    SpscRing<std::string> ring(4);
+    BOOST_CHECK_EQUAL( ring.capacity(), 4 );
+    BOOST_CHECK( ring.empty() );
+
+    std::string value;
+    BOOST_CHECK( !ring.try_pop(value) );
+    for(auto i = 0; i < 4; ++i) BOOST_CHECK( ring.try_push(std::to_string(i)) );
+    std::string rejected = "rejected";
+    BOOST_CHECK( !ring.try_push(std::move(rejected)) );
+    BOOST_CHECK_EQUAL( rejected, "rejected" );
+
+    // Wrapping around
+    for(auto i = 4; i < 10; ++i) {
+      BOOST_REQUIRE( ring.try_pop(value) );
+      BOOST_CHECK_EQUAL( value, std::to_string(i - 4) );
+      BOOST_CHECK( ring.try_push(std::to_string(i)) );
+    }
+    for(auto i = 6; i < 10; ++i) {
+      BOOST_REQUIRE( ring.try_pop(value) );
+      BOOST_CHECK_EQUAL( value, std::to_string(i) );
+    }
+    BOOST_CHECK( ring.empty() );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_threads )
+  {
+    constexpr size_t NUM_VALUES = 1000000;
+    SpscRing<size_t> ring(64);
+    std::thread producer([&]{
+      for(size_t i = 0; i < NUM_VALUES; ++i) {
+        while(!ring.try_push(size_t(i))) std::this_thread::yield();
+      }
+    });
+
+    size_t expected = 0, value;
+    bool ordered = true;
+    while(expected < NUM_VALUES) {
+      if(!ring.try_pop(value)) continue;
+      ordered = ordered && value == expected;
+      ++expected;
+    }
+    producer.join();
+    BOOST_CHECK( ordered );
+    BOOST_CHECK( ring.empty() );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
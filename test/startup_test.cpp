@@ -0,0 +1,87 @@
+/*
+ * Check of the startup time, built as an executable of its own to be run or
+ * skipped apart from the unit tests, e.g. `ctest -LE timing`.
+ */
+#define BOOST_TEST_MODULE startup_test
+#include <boost/test/included/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <cstdlib>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+
+namespace {
+
+  using clock_type = std::chrono::steady_clock;
+
+  // The budget is set by CLI_STARTUP_BUDGET_MS of CMake
+  constexpr auto STARTUP_BUDGET = std::chrono::milliseconds(CLI_STARTUP_BUDGET_MS);
+  constexpr size_t NUM_RUNS = 21;
+
+  //! Spawn the engine, and returns the time until its first prompt
+  clock_type::duration time_to_first_prompt()
+  {
+    int input[2], output[2];
+    BOOST_REQUIRE( ::pipe(input) == 0 );
+    BOOST_REQUIRE( ::pipe(output) == 0 );
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+    for(auto fd : { input[0], input[1], output[0], output[1] }) posix_spawn_file_actions_addclose(&actions, fd);
+    std::string path(CLI_BASIC_ENGINE_EXEC), option("--disable-logging");
+    char* argv[] = { &path[0], &option[0], nullptr };
+
+    const auto start = clock_type::now();
+    pid_t pid;
+    const auto error = posix_spawn(&pid, argv[0], &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(input[0]);
+    ::close(output[1]);
+    BOOST_REQUIRE_EQUAL( error, 0 );
+
+    std::string prompt;
+    char buffer[2];
+    while(prompt.size() < 2) {
+      auto size = ::read(output[0], buffer, 2 - prompt.size());
+      if(size <= 0) break;
+      prompt.append(buffer, size);
+    }
+    const auto elapsed = clock_type::now() - start;
+
+    // The end of input stops the engine
+    ::close(input[1]);
+    while(::read(output[0], buffer, sizeof(buffer)) > 0);
+    ::close(output[0]);
+    int status;
+    ::waitpid(pid, &status, 0);
+    BOOST_CHECK_EQUAL( prompt, "> " );
+    BOOST_CHECK( WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS );
+    return elapsed;
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( startup_test )
+
+  BOOST_AUTO_TEST_CASE( test_first_prompt )
+  {
+    std::vector<clock_type::duration> times;
+    for(size_t i = 0; i < NUM_RUNS; ++i) times.push_back(time_to_first_prompt());
+    std::nth_element(times.begin(), times.begin() + NUM_RUNS / 2, times.end());
+    const auto median = std::chrono::duration_cast<std::chrono::microseconds>(times[NUM_RUNS / 2]);
+    BOOST_TEST_MESSAGE( "median time to the first prompt: " << median.count() << " us" );
+    BOOST_CHECK_LE( median.count(), std::chrono::duration_cast<std::chrono::microseconds>(STARTUP_BUDGET).count() );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,57 @@
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <ctime>
+
+#include "../timestamp.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  std::string format(TimestampFormatter& formatter, uint64_t timestamp)
+  {
+    char buffer[TimestampFormatter::MAX_SIZE];
+    return std::string(buffer, formatter.format(timestamp, buffer));
+  }
+
+}
+
+
+BOOST_AUTO_TEST_SUITE( timestamp_test )
+
+  BOOST_AUTO_TEST_CASE( test_monotonic )
+  {
+    auto previous = Timestamp::now();
+    for(auto i = 0; i < 1000; ++i) {
+      auto now = Timestamp::now();
+      BOOST_CHECK( now >= previous );
+      previous = now;
+    }
+    auto wall = static_cast<uint64_t>(std::time(nullptr));
+    BOOST_CHECK( previous / 1000000000 + 1 >= wall && previous / 1000000000 <= wall + 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_same_format_as_boost )
+  {
+    const std::time_t second = 1451703845;  // 2016-01-02 03:04:05 UTC
+    std::tm local;
+    ::localtime_r(&second, &local);
+    auto expected = boost::posix_time::to_simple_string(boost::posix_time::ptime_from_tm(local));
+
+    TimestampFormatter formatter(TimestampResolution::SECOND);
+    const uint64_t timestamp = second * 1000000000ull + 123456789;
+    BOOST_CHECK_EQUAL( format(formatter, timestamp), expected );
+
+    formatter.set_resolution(TimestampResolution::MILLISECOND);
+    BOOST_CHECK_EQUAL( format(formatter, timestamp), expected + ".123" );
+    formatter.set_resolution(TimestampResolution::MICROSECOND);
+    BOOST_CHECK_EQUAL( format(formatter, timestamp), expected + ".123456" );
+    formatter.set_resolution(TimestampResolution::NANOSECOND);
+    BOOST_CHECK_EQUAL( format(formatter, timestamp), expected + ".123456789" );
+    BOOST_CHECK_EQUAL( format(formatter, timestamp - 123456789 + 1000), expected + ".000001000" );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,116 @@
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "../trace.hpp"
+#include "../engine.hpp"
+#include "../command.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  class TraceFileFixture {
+    public:
+    TraceFileFixture()
+      : path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("cli_trace_test-%%%%%%%%.json"))
+    {
+    }
+
+    ~TraceFileFixture()
+    {
+      boost::filesystem::remove(path);
+    }
+
+    std::string read() const
+    {
+      std::ifstream file(path.string());
+      return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    //! Returns the number of the occurrences of the text in the trace
+    size_t count(const std::string& text) const
+    {
+      const auto trace = read();
+      size_t num = 0;
+      for(auto found = trace.find(text); found != std::string::npos; found = trace.find(text, found + 1)) ++num;
+      return num;
+    }
+
+    boost::filesystem::path path;
+  };
+
+  class TracingEngine : public Engine {
+    public:
+    TracingEngine()
+    {
+      register_callback("load", [this](Command&){
+        CLI_TRACE_SPAN(tracer(), "load");
+      });
+    }
+  };
+
+}
+
+
+BOOST_FIXTURE_TEST_SUITE( trace_test, TraceFileFixture )
+
+  BOOST_AUTO_TEST_CASE( test_spans )
+  {
+    Tracer tracer;
+    { TraceSpan span(tracer, "disabled"); }
+
+    tracer.open(path.string(), 3);
+    BOOST_CHECK( tracer.enabled() );
+    { TraceSpan span(tracer, "span", "\"quoted\"\n"); }
+    std::thread([&]{ CLI_TRACE_SPAN(tracer, "thread"); }).join();
+    for(auto i = 0; i < 3; ++i) {
+      CLI_TRACE_SPAN(tracer, "limited");
+    }
+    BOOST_REQUIRE( tracer.close() );
+    BOOST_CHECK( !tracer.enabled() );
+
+    const auto trace = read();
+    BOOST_CHECK_EQUAL( trace.compare(0, 15, "{\"traceEvents\":"), 0 );
+    BOOST_CHECK_EQUAL( count("\"ph\":\"X\""), 4 );
+    BOOST_CHECK_EQUAL( count("\"disabled\""), 0 );
+    BOOST_CHECK_EQUAL( count("\"limited\""), 2 );
+    BOOST_CHECK_EQUAL( count("\"dropped_events\":1"), 1 );
+    BOOST_CHECK_EQUAL( count("{\"detail\":\"\\\"quoted\\\"\\u000a\"}"), 1 );
+    BOOST_CHECK_EQUAL( count("\"thread\",\"cat\":\"cli\",\"ph\":\"X\""), 1 );
+    BOOST_CHECK_EQUAL( count("\"tid\":1"), 3 );
+    BOOST_CHECK_EQUAL( count("\"tid\":2"), 1 );
+
+    // Reopening discards the spans written before
+    tracer.open(path.string(), 10);
+    BOOST_REQUIRE( tracer.close() );
+    BOOST_CHECK_EQUAL( count("\"ph\":\"X\""), 0 );
+  }
+
+  BOOST_AUTO_TEST_CASE( test_engine_spans )
+  {
+    const auto trace_file = path.string();
+    const char* argv[] = { "trace_test", "--disable-logging", "--trace-file", trace_file.c_str() };
+    TracingEngine engine;
+    engine.initialize(4, argv);
+    std::istringstream is("echo hello\nload\nunknown\n");
+    std::ostringstream os;
+    engine.main_loop(is, os);
+
+    // The last read reaches the end of the input
+    BOOST_CHECK_EQUAL( count("\"read\""), 4 );
+    for(auto name : { "\"parse\"", "\"lookup\"", "\"log\"", "\"write\"" }) {
+      BOOST_CHECK_EQUAL( count(name), 3 );
+    }
+    BOOST_CHECK_EQUAL( count("\"callback\""), 2 );
+    BOOST_CHECK_EQUAL( count("{\"detail\":\"load\"}"), 1 );
+    BOOST_CHECK_EQUAL( count("\"load\",\"cat\""), 1 );
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
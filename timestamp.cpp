@@ -0,0 +1,96 @@
+#include <chrono>
+
+#include <cstring>
+#include <ctime>
+
+#include "timestamp.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  constexpr uint64_t NANOSECONDS_PER_SECOND = 1000000000;
+
+  const char* const MONTHS[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+  };
+
+  struct Anchor {
+    int64_t wall;
+    int64_t steady;
+
+    Anchor() noexcept
+      : wall(std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count()),
+        steady(std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count())
+    {
+    }
+  };
+
+  char* format_digits(char* tail, uint64_t value, int width) noexcept
+  {
+    for(auto i = 0; i < width; ++i) {
+      *--tail = static_cast<char>('0' + value % 10);
+      value /= 10;
+    }
+    return tail;
+  }
+
+}
+
+
+uint64_t Timestamp::now() noexcept
+{
+  static const Anchor anchor;
+  auto steady = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch()).count();
+  return static_cast<uint64_t>(anchor.wall + (steady - anchor.steady));
+}
+
+
+//--------------------------------------------------------
+TimestampFormatter::TimestampFormatter(TimestampResolution resolution) noexcept
+  : _resolution(resolution), _cached_second(-1), _cached_size(0)
+{
+}
+
+
+size_t TimestampFormatter::format(uint64_t timestamp, char* buffer) noexcept
+{
+  const auto second = static_cast<int64_t>(timestamp / NANOSECONDS_PER_SECOND);
+  if(second != _cached_second) {
+    // "YYYY-Mon-DD hh:mm:ss" as boost::posix_time::to_simple_string
+    std::time_t time = second;
+    std::tm local;
+    ::localtime_r(&time, &local);
+    char* tail = _cached_prefix + 20;
+    tail = format_digits(tail, local.tm_sec, 2);
+    *--tail = ':';
+    tail = format_digits(tail, local.tm_min, 2);
+    *--tail = ':';
+    tail = format_digits(tail, local.tm_hour, 2);
+    *--tail = ' ';
+    tail = format_digits(tail, local.tm_mday, 2);
+    *--tail = '-';
+    tail -= 3;
+    std::memcpy(tail, MONTHS[local.tm_mon], 3);
+    *--tail = '-';
+    format_digits(tail, local.tm_year + 1900, 4);
+    _cached_size = 20;
+    _cached_second = second;
+  }
+
+  std::memcpy(buffer, _cached_prefix, _cached_size);
+  auto size = _cached_size;
+  auto digits = static_cast<int>(_resolution);
+  if(digits > 0) {
+    auto fraction = timestamp % NANOSECONDS_PER_SECOND;
+    for(auto i = digits; i < 9; ++i) fraction /= 10;
+    buffer[size++] = '.';
+    format_digits(buffer + size + digits, fraction, digits);
+    size += digits;
+  }
+  return size;
+}
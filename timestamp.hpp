@@ -0,0 +1,93 @@
+/*!
+ * @file  timestamp.hpp
+ * @brief High-resolution timestamps and their cached formatting
+ */
+#ifndef CLI_BASIC_ENGINE_TIMESTAMP_HPP
+#define CLI_BASIC_ENGINE_TIMESTAMP_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace cli {
+
+  //! The number of fractional digits of formatted timestamps
+  enum struct TimestampResolution {
+    SECOND      = 0,
+    MILLISECOND = 3,
+    MICROSECOND = 6,
+    NANOSECOND  = 9
+  };
+
+
+  /*!
+   * @brief  Wall clock time driven by the monotonic clock
+   * @note   The monotonic clock is anchored to the wall clock at the first use,
+   *         so timestamps never go backward even if the system time is adjusted.
+   */
+  struct Timestamp {
+
+    /*!
+     * @brief   Returns the current time
+     * @return  nanoseconds since the UNIX epoch
+     */
+    static uint64_t now() noexcept;
+
+  };
+
+
+  /*!
+   * @brief  Formatter of timestamps in local time, e.g. "2016-Jan-02 03:04:05.678901"
+   * @note   The date and seconds are rendered only when the second changes; the
+   *         fractional part is rendered every time. Use an instance per thread.
+   * @code
+   * // Usage
+   * TimestampFormatter formatter( TimestampResolution::MICROSECOND );
+   * char buffer[TimestampFormatter::MAX_SIZE];
+   * auto size = formatter.format( Timestamp::now(), buffer );
+   * @endcode
+   */
+  class TimestampFormatter {
+
+    public:
+    /*!
+     * @var    MAX_SIZE
+     * @brief  Size of the buffer enough to store any formatted timestamp
+     */
+    static constexpr size_t MAX_SIZE = 32;
+
+    //! Ctor.
+    explicit TimestampFormatter(TimestampResolution resolution = TimestampResolution::MICROSECOND) noexcept;
+
+    /*!
+     * @brief       Format the timestamp
+     * @param[in]   timestamp : nanoseconds since the UNIX epoch
+     * @param[out]  buffer    : buffer of MAX_SIZE characters at least (not null terminated)
+     * @return      the number of written characters
+     */
+    size_t format(uint64_t timestamp, char* buffer) noexcept;
+
+    //! Returns the resolution
+    TimestampResolution resolution() const noexcept
+    {
+      return _resolution;
+    }
+
+    //! Change the resolution
+    void set_resolution(TimestampResolution resolution) noexcept
+    {
+      _resolution = resolution;
+    }
+
+
+    private:
+    TimestampResolution _resolution;
+    int64_t             _cached_second;
+    char                _cached_prefix[MAX_SIZE];
+    size_t              _cached_size;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_TIMESTAMP_HPP */
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "trace.hpp"
+
+
+using namespace cli;
+
+namespace {
+
+  // Generations of tracers are unique in the process, so that caches never match a closed one
+  std::atomic<uint64_t> last_generation(0);
+
+  //! Buffer of the thread for the tracer opened last on it
+  struct BufferCache {
+    uint64_t generation = 0;
+    void*    buffer     = nullptr;
+  };
+  thread_local BufferCache buffer_cache;
+
+  // Size of chunks of the JSON written to the file
+  constexpr size_t CHUNK_SIZE = 1024 * 1024;
+
+  void append_decimal(std::string& output, uint64_t value)
+  {
+    char digits[20];
+    size_t size = 0;
+    do {
+      digits[size++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while(value > 0);
+    while(size > 0) output += digits[--size];
+  }
+
+  //! Append ns as us with the fraction
+  void append_microseconds(std::string& output, int64_t ns)
+  {
+    const auto value = static_cast<uint64_t>(ns > 0 ? ns : 0);
+    append_decimal(output, value / 1000);
+    const auto fraction = value % 1000;
+    output += '.';
+    output += static_cast<char>('0' + fraction / 100);
+    output += static_cast<char>('0' + fraction / 10 % 10);
+    output += static_cast<char>('0' + fraction % 10);
+  }
+
+  void append_json_string(std::string& output, const char* data, size_t size)
+  {
+    output += '"';
+    for(size_t i = 0; i < size; ++i) {
+      const auto c = static_cast<unsigned char>(data[i]);
+      if(c == '"' || c == '\\') {
+        output += '\\';
+        output += data[i];
+      } else if(c < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        output += escaped;
+      } else {
+        output += data[i];
+      }
+    }
+    output += '"';
+  }
+
+}
+
+
+Tracer::Tracer() noexcept
+  : _enabled(false), _generation(0), _max_events(0)
+{
+}
+
+
+Tracer::~Tracer() noexcept
+{
+  try {
+    close();
+  } catch(const std::exception&) {
+    // Spans which cannot be written are lost
+  }
+}
+
+
+void Tracer::open(std::string path, size_t max_events)
+{
+  if(_enabled) close();
+  _buffers.clear();
+  _path       = std::move(path);
+  _max_events = max_events;
+  _generation = ++last_generation;
+  _start      = clock_type::now();
+  _enabled    = true;
+}
+
+
+bool Tracer::close()
+{
+  if(!_enabled) return true;
+  _enabled = false;
+
+  // Events are formatted into chunks, since they can be millions
+  std::ofstream os(_path);
+  const auto pid = std::to_string(::getpid());
+  size_t dropped = 0;
+  bool   first = true;
+  std::string chunk = "{\"traceEvents\":[";
+  chunk.reserve(CHUNK_SIZE + 256);
+  for(size_t tid = 0; tid < _buffers.size(); ++tid) {
+    const auto& buffer = *_buffers[tid];
+    dropped += buffer.dropped;
+    for(const auto& event : buffer.events) {
+      chunk += first ? "\n{\"name\":" : ",\n{\"name\":";
+      first = false;
+      append_json_string(chunk, event.name, std::strlen(event.name));
+      chunk += ",\"cat\":\"cli\",\"ph\":\"X\",\"ts\":";
+      append_microseconds(chunk, event.begin);
+      chunk += ",\"dur\":";
+      append_microseconds(chunk, event.duration);
+      chunk += ",\"pid\":";
+      chunk += pid;
+      chunk += ",\"tid\":";
+      append_decimal(chunk, tid + 1);
+      if(event.detail_size > 0) {
+        chunk += ",\"args\":{\"detail\":";
+        append_json_string(chunk, event.detail, event.detail_size);
+        chunk += '}';
+      }
+      chunk += '}';
+      if(chunk.size() >= CHUNK_SIZE) {
+        os.write(chunk.data(), chunk.size());
+        chunk.clear();
+      }
+    }
+  }
+  chunk += "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":";
+  append_decimal(chunk, dropped);
+  chunk += "}}\n";
+  os.write(chunk.data(), chunk.size());
+  _buffers.clear();
+  return static_cast<bool>(os.flush());
+}
+
+
+void Tracer::record(const char* name, clock_type::time_point begin, clock_type::time_point end,
+                    boost::string_ref detail) noexcept
+{
+  try {
+    auto& buffer = local_buffer();
+    if(buffer.events.size() >= _max_events) {
+      ++buffer.dropped;
+      return;
+    }
+    Event event;
+    event.name        = name;
+    event.begin       = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - _start).count();
+    event.duration    = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    event.detail_size = static_cast<uint8_t>(detail.size() < MAX_DETAIL_SIZE ? detail.size() : MAX_DETAIL_SIZE);
+    std::memcpy(event.detail, detail.data(), event.detail_size);
+    buffer.events.push_back(event);
+  } catch(const std::bad_alloc&) {
+    // Spans which cannot be buffered are lost
+  }
+}
+
+
+// Private functions
+//--------------------------------------------------------
+auto Tracer::local_buffer() -> ThreadBuffer&
+{
+  if(buffer_cache.generation == _generation) {
+    return *static_cast<ThreadBuffer*>(buffer_cache.buffer);
+  }
+
+  // The thread may have recorded to this tracer before another one took the cache
+  std::lock_guard<std::mutex> lock(_mutex);
+  const auto thread = std::this_thread::get_id();
+  auto found = std::find_if(_buffers.begin(), _buffers.end(),
+                            [&](const std::unique_ptr<ThreadBuffer>& buffer){ return buffer->thread == thread; });
+  if(found == _buffers.end()) {
+    _buffers.emplace_back(new ThreadBuffer{ thread, {}, 0 });
+    found = _buffers.end() - 1;
+  }
+  buffer_cache.generation = _generation;
+  buffer_cache.buffer     = found->get();
+  return **found;
+}
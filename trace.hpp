@@ -0,0 +1,151 @@
+/*!
+ * @file  trace.hpp
+ * @brief Spans of command handling written in the Chrome trace event format
+ */
+#ifndef CLI_BASIC_ENGINE_TRACE_HPP
+#define CLI_BASIC_ENGINE_TRACE_HPP
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+
+#define CLI_TRACE_CONCAT_IMPL(x, y) x##y
+#define CLI_TRACE_CONCAT(x, y) CLI_TRACE_CONCAT_IMPL(x, y)
+
+/*!
+ * @def    CLI_TRACE_SPAN
+ * @brief  Record a span from here to the end of the scope
+ * @code
+ * // Usage
+ * void MyEngine::load(Command& command)
+ * {
+ *   CLI_TRACE_SPAN(tracer(), "load");
+ *   ...
+ * }
+ * @endcode
+ */
+#define CLI_TRACE_SPAN(tracer, name) \
+  ::cli::TraceSpan CLI_TRACE_CONCAT(cli_trace_span_, __LINE__)((tracer), (name))
+
+
+namespace cli {
+
+  /*!
+   * @brief  Recorder of spans buffered per thread
+   * @note   Spans are appended to the buffer of the recording thread without a lock,
+   *         and all the buffers are written as a JSON file by close(), which can be
+   *         loaded by chrome://tracing or Perfetto. Nothing is recorded until open().
+   */
+  class Tracer : private boost::noncopyable {
+
+    public:
+    using clock_type = std::chrono::steady_clock;
+
+    //! The number of characters of span details kept in events
+    static constexpr size_t MAX_DETAIL_SIZE = 23;
+
+    Tracer() noexcept;
+
+    //! dtor. writes recorded spans if it is open
+    ~Tracer() noexcept;
+
+    /*!
+     * @brief      Start recording spans
+     * @param[in]  path       : path of the trace file, written by close()
+     * @param[in]  max_events : the number of events buffered per thread; the rest are dropped
+     */
+    void open(std::string path, size_t max_events);
+
+    /*!
+     * @brief   Stop recording, and write the recorded spans
+     * @retval  false : the file cannot be written
+     * @attention  No span may be recorded concurrently.
+     */
+    bool close();
+
+    //! Check spans are recorded
+    bool enabled() const noexcept
+    {
+      return _enabled;
+    }
+
+    /*!
+     * @brief      Record a span
+     * @param[in]  name   : name of the span; it must outlive the tracer, e.g. a literal
+     * @param[in]  detail : shown as the argument of the span, truncated to MAX_DETAIL_SIZE
+     */
+    void record(const char* name, clock_type::time_point begin, clock_type::time_point end,
+                boost::string_ref detail) noexcept;
+
+    private:
+    struct Event {
+      const char* name;
+      int64_t     begin;     // ns since open()
+      int64_t     duration;  // ns
+      uint8_t     detail_size;
+      char        detail[MAX_DETAIL_SIZE];
+    };
+
+    struct ThreadBuffer {
+      std::thread::id    thread;
+      std::vector<Event> events;
+      size_t             dropped;
+    };
+
+    ThreadBuffer& local_buffer();
+
+    private:
+    bool                   _enabled;
+    uint64_t               _generation;  // distinguishes open() calls in caches of threads
+    std::string            _path;
+    size_t                 _max_events;
+    clock_type::time_point _start;
+    std::mutex             _mutex;       // guards the list of buffers
+    std::vector<std::unique_ptr<ThreadBuffer>> _buffers;
+
+  };
+
+
+  /*!
+   * @brief  Span recorded from its construction to its destruction
+   * @note   It costs a branch if the tracer is not enabled.
+   */
+  class TraceSpan : private boost::noncopyable {
+
+    public:
+    /*!
+     * @param[in]  tracer : tracer recording the span
+     * @param[in]  name   : name of the span; it must outlive the tracer, e.g. a literal
+     * @param[in]  detail : [optional] argument of the span; it must live until the span ends
+     */
+    TraceSpan(Tracer& tracer, const char* name, boost::string_ref detail = boost::string_ref()) noexcept
+      : _tracer(tracer.enabled() ? &tracer : nullptr), _name(name), _detail(detail)
+    {
+      if(_tracer != nullptr) _begin = Tracer::clock_type::now();
+    }
+
+    ~TraceSpan() noexcept
+    {
+      if(_tracer != nullptr) _tracer->record(_name, _begin, Tracer::clock_type::now(), _detail);
+    }
+
+    private:
+    Tracer*                        _tracer;  // null if the tracer is not enabled
+    const char*                    _name;
+    boost::string_ref              _detail;
+    Tracer::clock_type::time_point _begin;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_TRACE_HPP */
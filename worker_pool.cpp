@@ -0,0 +1,78 @@
+#include "worker_pool.hpp"
+
+
+using namespace cli;
+
+
+WorkerPool::WorkerPool(size_t num_workers)
+  : _task(nullptr), _size(0), _next(0), _running(0), _generation(0), _stopping(false)
+{
+  _threads.reserve(num_workers);
+  for(size_t i = 0; i < num_workers; ++i) {
+    _threads.emplace_back(&WorkerPool::work, this);
+  }
+}
+
+
+WorkerPool::~WorkerPool() noexcept
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _started.notify_all();
+  for(auto& thread : _threads) thread.join();
+}
+
+
+void WorkerPool::parallel_for(size_t size, const task_type& task)
+{
+  if(size == 0) return;
+  if(size == 1 || _threads.empty()) {
+    for(size_t i = 0; i < size; ++i) task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _task = &task, _size = size, _next = 0;
+    _running = _threads.size();
+    ++_generation;
+  }
+  _started.notify_all();
+
+  run_tasks();
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _finished.wait(lock, [this]{ return _running == 0; });
+  _task = nullptr;
+}
+
+
+// Private functions
+//--------------------------------------------------------
+void WorkerPool::work()
+{
+  uint64_t generation = 0;
+  for(;;) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _started.wait(lock, [&]{ return _stopping || _generation != generation; });
+      if(_stopping) return;
+      generation = _generation;
+    }
+
+    run_tasks();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(--_running == 0) _finished.notify_one();
+  }
+}
+
+
+void WorkerPool::run_tasks() noexcept
+{
+  for(auto i = _next++; i < _size; i = _next++) {
+    (*_task)(i);
+  }
+}
@@ -0,0 +1,84 @@
+/*!
+ * @file  worker_pool.hpp
+ * @brief Fixed-size pool of worker threads
+ */
+#ifndef CLI_BASIC_ENGINE_WORKER_POOL_HPP
+#define CLI_BASIC_ENGINE_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace cli {
+
+  /*!
+   * @brief  Pool of threads running indexed tasks in parallel
+   * @code
+   * // Usage
+   * WorkerPool pool( 4 );
+   * std::vector<int> values( 100 );
+   * pool.parallel_for( values.size(), [&](size_t i){ values[i] = f(i); } );
+   * @endcode
+   */
+  class WorkerPool : private boost::noncopyable {
+
+    public:
+    /*!
+     * @typedef  task_type
+     * @brief    Type of the task called with an index
+     */
+    using task_type = std::function<void(size_t)>;
+
+    /*!
+     * @brief      Ctor. starts the workers
+     * @param[in]  num_workers : the number of worker threads
+     */
+    explicit WorkerPool(size_t num_workers);
+
+    //! dtor. joins the workers
+    ~WorkerPool() noexcept;
+
+    //! Returns the number of worker threads
+    size_t size() const noexcept
+    {
+      return _threads.size();
+    }
+
+    /*!
+     * @brief      Run task(i) for every i in [0, size)
+     * @param[in]  size : the number of indices
+     * @param[in]  task : task which must not throw
+     * @note       The calling thread also runs tasks, and it returns when all of them are done.
+     */
+    void parallel_for(size_t size, const task_type& task);
+
+
+    private:
+    void work();
+    void run_tasks() noexcept;
+
+    private:
+    std::vector<std::thread> _threads;
+    std::mutex               _mutex;
+    std::condition_variable  _started;
+    std::condition_variable  _finished;
+    const task_type*         _task;
+    size_t                   _size;
+    std::atomic<size_t>      _next;
+    size_t                   _running;
+    uint64_t                 _generation;
+    bool                     _stopping;
+
+  };
+
+}
+
+#endif  /* CLI_BASIC_ENGINE_WORKER_POOL_HPP */